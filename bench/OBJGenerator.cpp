@@ -0,0 +1,273 @@
+#include "OBJGenerator.hpp"
+#include <ostream>
+#include <vector>
+#include <charconv>
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+
+using namespace std;
+
+static const float PI = 3.14159265358979f;
+static const float GRID_WAVES = 8.0f;      // sine periods across the grid
+static const float GRID_AMPLITUDE = 0.05f;
+
+/**
+* @brief Formats records into a 1 MiB buffer and hands it to the stream
+* in large writes; to_chars keeps the numbers locale-free and short.
+*/
+class OBJWriter {
+public:
+	explicit OBJWriter(ostream &out) : _out(out) {
+		_buffer.resize(BUFFER_SIZE);
+	}
+
+	~OBJWriter() {
+		flush();
+	}
+
+	void vertex(const char *type, const float *values, int count) {
+		reserve(16 + count * 16);
+		append(type);
+		for (int k = 0; k < count; k++) {
+			_buffer[_used++] = ' ';
+			_used = to_chars(&_buffer[_used], &_buffer[0] + _buffer.size(), values[k]).ptr - &_buffer[0];
+		}
+		_buffer[_used++] = '\n';
+	}
+
+	// one face; `corners` are 0-based vertex indices, written 1-based for every field
+	void face(const size_t *corners, size_t count, bool texCoords, bool normals) {
+		reserve(2 + count * 64);
+		_buffer[_used++] = 'f';
+		for (size_t k = 0; k < count; k++) {
+			const size_t corner = corners[k];
+			_buffer[_used++] = ' ';
+			writeIndex(corner + 1);
+			if (texCoords || normals) {
+				_buffer[_used++] = '/';
+				if (texCoords) {
+					writeIndex(corner + 1);
+				}
+			}
+			if (normals) {
+				_buffer[_used++] = '/';
+				writeIndex(corner + 1);
+			}
+		}
+		_buffer[_used++] = '\n';
+	}
+
+	size_t getBytes() const {
+		return _written + _used;
+	}
+
+private:
+	static const size_t BUFFER_SIZE = 1 << 20;
+
+	ostream &_out;
+	vector<char> _buffer;
+	size_t _used = 0;
+	size_t _written = 0;
+
+	void flush() {
+		_out.write(_buffer.data(), _used);
+		_written += _used;
+		_used = 0;
+	}
+
+	void reserve(size_t bytes) {
+		if (_used + bytes > _buffer.size()) {
+			flush();
+		}
+		if (bytes > _buffer.size()) {
+			_buffer.resize(bytes);
+		}
+	}
+
+	void append(const char *text) {
+		while (*text) {
+			_buffer[_used++] = *text++;
+		}
+	}
+
+	void writeIndex(size_t index) {
+		_used = to_chars(&_buffer[_used], &_buffer[0] + _buffer.size(), index).ptr - &_buffer[0];
+	}
+};
+
+static void writeTriangle(OBJWriter &writer, size_t a, size_t b, size_t c, const OBJGeneratorOptions &options) {
+	const size_t corners[3] = {a, b, c};
+	writer.face(corners, 3, options.texCoords, options.normals);
+}
+
+bool OBJGenerator::isValidPolygonSize(unsigned polygonSize) {
+	return polygonSize == 3 || (polygonSize >= 4 && polygonSize % 2 == 0);
+}
+
+/**
+* @brief Faces between two rows of vertices, `first` and `second`, each
+* with `cells` + 1 entries (the sphere repeats its seam vertex index).
+*
+* Triangles split every cell in two; larger polygons walk `first` forward
+* over polygonSize / 2 - 1 cells and come back along `second`, which keeps
+* the winding of the triangles.
+*/
+static void writeBand(OBJWriter &writer, const vector<size_t> &first, const vector<size_t> &second,
+	const OBJGeneratorOptions &options, OBJGeneratorStats &stats)
+{
+	const size_t cells = first.size() - 1;
+	vector<size_t> corners;
+
+	if (options.polygonSize == 3) {
+		for (size_t i = 0; i < cells; i++) {
+			writeTriangle(writer, first[i], first[i + 1], second[i + 1], options);
+			writeTriangle(writer, first[i], second[i + 1], second[i], options);
+		}
+		stats.faces += cells * 2;
+		stats.triangles += cells * 2;
+		return;
+	}
+
+	const size_t span = options.polygonSize / 2 - 1;
+	for (size_t i = 0; i < cells; i += span) {
+		const size_t end = min(i + span, cells);
+		corners.clear();
+		for (size_t k = i; k <= end; k++) {
+			corners.push_back(first[k]);
+		}
+		for (size_t k = end + 1; k-- > i;) {
+			corners.push_back(second[k]);
+		}
+		writer.face(corners.data(), corners.size(), options.texCoords, options.normals);
+		stats.faces++;
+		stats.triangles += corners.size() - 2;
+	}
+}
+
+static void writeGrid(OBJWriter &writer, const OBJGeneratorOptions &options, OBJGeneratorStats &stats) {
+	const size_t cells = max<size_t>(1, static_cast<size_t>(ceil(sqrt(options.triangles / 2.0))));
+	const float frequency = GRID_WAVES * 2.0f * PI;
+
+	for (size_t j = 0; j <= cells; j++) {
+		for (size_t i = 0; i <= cells; i++) {
+			float u = static_cast<float>(i) / cells;
+			float v = static_cast<float>(j) / cells;
+			float x = u * 2.0f - 1.0f;
+			float y = v * 2.0f - 1.0f;
+			float position[3] = {x, y, GRID_AMPLITUDE * sin(frequency * u) * cos(frequency * v)};
+			writer.vertex("v", position, 3);
+
+			if (options.texCoords) {
+				float uv[2] = {u, v};
+				writer.vertex("vt", uv, 2);
+			}
+			if (options.normals) {
+				// -dz/dx, -dz/dy, 1 with x, y spanning 2 units per grid
+				float dx = GRID_AMPLITUDE * frequency * 0.5f * cos(frequency * u) * cos(frequency * v);
+				float dy = -GRID_AMPLITUDE * frequency * 0.5f * sin(frequency * u) * sin(frequency * v);
+				float length = sqrt(dx * dx + dy * dy + 1.0f);
+				float normal[3] = {-dx / length, -dy / length, 1.0f / length};
+				writer.vertex("vn", normal, 3);
+			}
+		}
+	}
+	stats.vertices = (cells + 1) * (cells + 1);
+
+	vector<size_t> first(cells + 1), second(cells + 1);
+	for (size_t j = 0; j < cells; j++) {
+		for (size_t i = 0; i <= cells; i++) {
+			first[i] = j * (cells + 1) + i;
+			second[i] = (j + 1) * (cells + 1) + i;
+		}
+		writeBand(writer, first, second, options, stats);
+	}
+}
+
+/**
+* @brief UV sphere of `rings` latitude bands and 2 * rings segments. The
+* poles are one polygon each, or triangle fans around a pole vertex.
+*/
+static void writeSphere(OBJWriter &writer, const OBJGeneratorOptions &options, OBJGeneratorStats &stats) {
+	const size_t rings = max<size_t>(3, static_cast<size_t>(round(sqrt(options.triangles / 4.0))));
+	const size_t segments = rings * 2;
+	const bool poleVertices = (options.polygonSize == 3);
+
+	auto writeVertex = [&](float theta, float phi, float u, float v) {
+		float position[3] = {sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)};
+		writer.vertex("v", position, 3);
+		if (options.texCoords) {
+			float uv[2] = {u, v};
+			writer.vertex("vt", uv, 2);
+		}
+		if (options.normals) {
+			writer.vertex("vn", position, 3);
+		}
+	};
+
+	for (size_t r = 1; r < rings; r++) {
+		for (size_t s = 0; s < segments; s++) {
+			writeVertex(PI * r / rings, 2.0f * PI * s / segments,
+				static_cast<float>(s) / segments, 1.0f - static_cast<float>(r) / rings);
+		}
+	}
+	const size_t north = (rings - 1) * segments;
+	const size_t south = north + 1;
+	if (poleVertices) {
+		writeVertex(0.0f, 0.0f, 0.5f, 1.0f);
+		writeVertex(PI, 0.0f, 0.5f, 0.0f);
+	}
+	stats.vertices = north + (poleVertices ? 2 : 0);
+
+	auto ring = [segments](size_t r, vector<size_t> &out) {
+		for (size_t s = 0; s <= segments; s++) {
+			out[s] = (r - 1) * segments + s % segments;
+		}
+	};
+
+	vector<size_t> first(segments + 1), second(segments + 1);
+	for (size_t r = 1; r + 1 < rings; r++) {
+		ring(r, first);
+		ring(r + 1, second);
+		writeBand(writer, first, second, options, stats);
+	}
+
+	// caps, wound to face away from the center
+	const size_t last = rings - 1;
+	if (poleVertices) {
+		for (size_t s = 0; s < segments; s++) {
+			size_t next = (s + 1) % segments;
+			writeTriangle(writer, north, next, s, options);
+			writeTriangle(writer, south, (last - 1) * segments + s, (last - 1) * segments + next, options);
+		}
+		stats.faces += segments * 2;
+		stats.triangles += segments * 2;
+		return;
+	}
+
+	vector<size_t> cap(segments);
+	for (size_t s = 0; s < segments; s++) {
+		cap[s] = segments - 1 - s;
+	}
+	writer.face(cap.data(), cap.size(), options.texCoords, options.normals);
+	for (size_t s = 0; s < segments; s++) {
+		cap[s] = (last - 1) * segments + s;
+	}
+	writer.face(cap.data(), cap.size(), options.texCoords, options.normals);
+	stats.faces += 2;
+	stats.triangles += (segments - 2) * 2;
+}
+
+OBJGeneratorStats OBJGenerator::write(ostream &out, const OBJGeneratorOptions &options) {
+	OBJGeneratorStats stats;
+	{
+		OBJWriter writer(out);
+		if (options.shape == OBJGeneratorOptions::SPHERE) {
+			writeSphere(writer, options, stats);
+		} else {
+			writeGrid(writer, options, stats);
+		}
+		stats.bytes = writer.getBytes();
+	}
+	return stats;
+}
@@ -0,0 +1,47 @@
+/**
+* @file OBJGenerator.hpp
+* @brief Writes synthetic OBJ files of any size for the loader benchmarks.
+*
+* Two shapes are available: a height-field grid and a UV sphere whose
+* poles are closed by one polygon each. Faces are triangles, or strips of
+* grid cells with an even number of corners (4 = quads, 6 = two cells,
+* ...). Any mix of the vt and vn fields can be written; every corner uses
+* the same index for all of its fields.
+*/
+
+#pragma once
+
+#include <ostream>
+#include <cstddef>
+
+struct OBJGeneratorOptions {
+	enum Shape {
+		GRID,
+		SPHERE,
+	};
+
+	Shape shape = GRID;
+	size_t triangles = 1000000;  // approximate, after triangulation by the loader
+	unsigned polygonSize = 3;    // corners per face: 3, or an even number >= 4
+	bool texCoords = true;
+	bool normals = true;
+};
+
+struct OBJGeneratorStats {
+	size_t vertices = 0;
+	size_t faces = 0;
+	size_t triangles = 0;  // the loader's triangle count after fan triangulation
+	size_t bytes = 0;
+};
+
+namespace OBJGenerator {
+	bool isValidPolygonSize(unsigned polygonSize);
+
+	/**
+	* @brief Streams the model described by `options` into `out`.
+	*
+	* The output only depends on the options, so two runs produce
+	* byte-identical files.
+	*/
+	OBJGeneratorStats write(std::ostream &out, const OBJGeneratorOptions &options);
+}
@@ -0,0 +1,217 @@
+/**
+* @file benchLoader.cpp
+* @brief Times the RenderModelLoader stages and prints the results as JSON.
+*
+* Every model is loaded `--runs` times without the mesh cache. For each
+* stage (parse, normals, bounds, build) and the whole load the median,
+* the 95th percentile and the file bytes per second at the median are
+* reported, so two versions can be compared run against run.
+*
+* Without file arguments a suite is generated into the temp directory:
+* grid and sphere models with triangles, quads and hexagons and different
+* v/vt/vn mixes, `--triangles` triangles each. The files are removed
+* afterwards.
+*
+* Usage: ./bench_loader [--runs N] [--triangles N] [file.obj ...]
+*/
+
+#include "OBJGenerator.hpp"
+#include "../src/modelLoader/RenderModelLoader.hpp"
+#include "../src/modelLoader/PositionArrays.hpp"
+#include "../src/jobs/JobSystem.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <cstdlib>
+
+using namespace std;
+
+static const char *STAGE_NAMES[] = {"parse", "normals", "bounds", "build", "total"};
+static const size_t STAGE_COUNT = sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]);
+
+struct SuiteModel {
+	const char *name;
+	OBJGeneratorOptions::Shape shape;
+	unsigned polygonSize;
+	bool texCoords;
+	bool normals;
+};
+
+static const SuiteModel SUITE[] = {
+	{"grid_tri_v_vt_vn", OBJGeneratorOptions::GRID, 3, true, true},
+	{"grid_quad_v_vt", OBJGeneratorOptions::GRID, 4, true, false},
+	{"grid_hex_v", OBJGeneratorOptions::GRID, 6, false, false},
+	{"sphere_tri_v", OBJGeneratorOptions::SPHERE, 3, false, false},
+	{"sphere_quad_v_vn", OBJGeneratorOptions::SPHERE, 4, false, true},
+};
+
+struct ModelResult {
+	string path;
+	size_t bytes = 0;
+	size_t triangles = 0;
+	size_t vertices = 0;
+	array<vector<double>, STAGE_COUNT> samples;
+};
+
+static string quoteJSON(const string &text) {
+	string quoted = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+		}
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+// nearest-rank percentile of unsorted samples
+static double percentile(vector<double> samples, double fraction) {
+	sort(samples.begin(), samples.end());
+	size_t rank = static_cast<size_t>(ceil(fraction * samples.size()));
+	return samples[min(samples.size(), max<size_t>(rank, 1)) - 1];
+}
+
+static ModelResult runModel(const string &path, int runs) {
+	ModelResult result;
+	result.path = path;
+	result.bytes = filesystem::file_size(path);
+
+	LoaderOptions options;
+	options.useMeshCache = false;
+
+	for (int run = 0; run < runs; run++) {
+		// the loader reports every stage on cout, keep it out of the JSON
+		ostringstream discarded;
+		streambuf *previous = cout.rdbuf(discarded.rdbuf());
+
+		auto start = chrono::steady_clock::now();
+		try {
+			RenderModelLoader loader(path, options);
+			chrono::duration<double, milli> total = chrono::steady_clock::now() - start;
+			cout.rdbuf(previous);
+
+			const LoaderTimings &timings = loader.getTimings();
+			const double stages[STAGE_COUNT] = {
+				timings.parseMs, timings.normalsMs, timings.boundsMs, timings.buildMs, total.count(),
+			};
+			for (size_t k = 0; k < STAGE_COUNT; k++) {
+				result.samples[k].push_back(stages[k]);
+			}
+
+			MeshBuffers mesh = loader.takeMesh();
+			MeshView view = mesh.getView();
+			result.vertices = mesh.getVertexCount();
+			result.triangles = (view.lods.empty() ? view.indices.size() : view.lods[0].indexCount) / 3;
+		} catch (...) {
+			cout.rdbuf(previous);
+			throw;
+		}
+	}
+	return result;
+}
+
+static void printJSON(const vector<ModelResult> &results, int runs) {
+	cout << "{\n"
+		<< "  \"runs\": " << runs << ",\n"
+		<< "  \"threads\": " << JobSystem::getShared().getWorkerCount() + 1 << ",\n"
+		<< "  \"position_kernels\": \"" << PositionKernels::getInstructionSet() << "\",\n"
+		<< "  \"models\": [\n";
+
+	for (size_t m = 0; m < results.size(); m++) {
+		const ModelResult &result = results[m];
+		cout << "    {\n"
+			<< "      \"file\": " << quoteJSON(result.path) << ",\n"
+			<< "      \"bytes\": " << result.bytes << ",\n"
+			<< "      \"triangles\": " << result.triangles << ",\n"
+			<< "      \"vertices\": " << result.vertices << ",\n"
+			<< "      \"stages\": {\n";
+
+		for (size_t k = 0; k < STAGE_COUNT; k++) {
+			double median = percentile(result.samples[k], 0.5);
+			double p95 = percentile(result.samples[k], 0.95);
+			double bytesPerSecond = (median > 0.0) ? result.bytes / (median / 1000.0) : 0.0;
+			cout << "        \"" << STAGE_NAMES[k] << "\": {\"median_ms\": " << median
+				<< ", \"p95_ms\": " << p95
+				<< ", \"bytes_per_s\": " << static_cast<unsigned long long>(bytesPerSecond) << "}"
+				<< (k + 1 < STAGE_COUNT ? "," : "") << "\n";
+		}
+
+		cout << "      }\n"
+			<< "    }" << (m + 1 < results.size() ? "," : "") << "\n";
+	}
+	cout << "  ]\n}\n";
+}
+
+static string generateModel(const SuiteModel &model, size_t triangles) {
+	OBJGeneratorOptions options;
+	options.shape = model.shape;
+	options.triangles = triangles;
+	options.polygonSize = model.polygonSize;
+	options.texCoords = model.texCoords;
+	options.normals = model.normals;
+
+	string path = (filesystem::temp_directory_path() / (string("scop_bench_") + model.name + ".obj")).string();
+	ofstream file(path, ios::binary);
+	OBJGenerator::write(file, options);
+	file.close();
+	if (!file) {
+		throw runtime_error("cannot write " + path);
+	}
+	return path;
+}
+
+int main(int argc, char *argv[]) {
+	int runs = 5;
+	size_t triangles = 1000000;
+	vector<string> paths;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--runs" && i + 1 < argc) {
+			runs = max(1, atoi(argv[++i]));
+		} else if (arg == "--triangles" && i + 1 < argc) {
+			triangles = strtoull(argv[++i], nullptr, 10);
+		} else if (arg[0] != '-') {
+			paths.push_back(arg);
+		} else {
+			cerr << "Usage: ./bench_loader [--runs N] [--triangles N] [file.obj ...]" << endl;
+			return 1;
+		}
+	}
+
+	const bool generated = paths.empty();
+	vector<ModelResult> results;
+	bool ok = true;
+	try {
+		if (generated) {
+			for (const SuiteModel &model : SUITE) {
+				paths.push_back(generateModel(model, triangles));
+			}
+		}
+		for (const string &path : paths) {
+			results.push_back(runModel(path, runs));
+		}
+	} catch (const exception &e) {
+		cerr << "bench_loader: " << e.what() << endl;
+		ok = false;
+	}
+
+	if (generated) {
+		for (const string &path : paths) {
+			filesystem::remove(path);
+		}
+	}
+
+	if (ok) {
+		printJSON(results, runs);
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+/**
+* @file benchMipmaps.cpp
+* @brief Microbenchmark: CPU mip chains, built and cached, for BMP textures.
+*
+* For every image: the BMP decode, a plain scalar 2x2 box filter over
+* all levels against MipChain::buildLevels() (which must give the same
+* bytes), and writing and reading the .scoptex cache. The images are
+* copied into the temp directory first, so their caches are written there.
+*
+* glGenerateMipmap() needs a GL context; `./scop ... --timings` prints the
+* load and upload time of its texture for `--mipmaps cpu` and `--mipmaps gpu`.
+* Block compression is timed by the `scoptex` tool.
+*
+* Usage: ./bench_mips [image.bmp ...]   (defaults to every .bmp in textureSources)
+*/
+
+#include "../src/texture/MipChain.hpp"
+#include "../src/texture/MipCache.hpp"
+#include "../src/texture/TextureImage.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <exception>
+#include <cstdint>
+
+using namespace std;
+
+// the levels of `base` without MipKernels, same rounding
+static vector<unsigned char> buildScalar(const MipChain &base) {
+	const uint32_t c = base.getChannels();
+	const MipLevel &top = base.getLevel(0);
+	vector<unsigned char> pixels(base.getLevelData(0), base.getLevelData(0) + top.size);
+	uint32_t width = top.width, height = top.height;
+	size_t offset = 0;
+
+	while (width > 1 || height > 1) {
+		const uint32_t outWidth = max<uint32_t>(1, width / 2), outHeight = max<uint32_t>(1, height / 2);
+		const size_t srcRow = MipChain::getRowBytes(width, c), dstRow = MipChain::getRowBytes(outWidth, c);
+		const size_t outOffset = pixels.size();
+		pixels.resize(outOffset + dstRow * outHeight);
+
+		for (uint32_t y = 0; y < outHeight; y++) {
+			const unsigned char *a = &pixels[offset + min(2 * y, height - 1) * srcRow];
+			const unsigned char *b = &pixels[offset + min(2 * y + 1, height - 1) * srcRow];
+			for (uint32_t x = 0; x < outWidth; x++) {
+				const size_t left = min(2 * x, width - 1) * c, right = min(2 * x + 1, width - 1) * c;
+				for (uint32_t k = 0; k < c; k++) {
+					pixels[outOffset + y * dstRow + x * c + k] =
+						static_cast<unsigned char>((a[left + k] + a[right + k] + b[left + k] + b[right + k] + 2) >> 2);
+				}
+			}
+		}
+		offset = outOffset;
+		width = outWidth;
+		height = outHeight;
+	}
+	return pixels;
+}
+
+template <typename Work>
+static double bestOf(int runs, Work work) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		auto start = chrono::steady_clock::now();
+		work();
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		best = min(best, elapsed.count());
+	}
+	return best;
+}
+
+static bool benchImage(const string &path, int runs) {
+	const filesystem::path copy = filesystem::temp_directory_path() / ("scop_bench_" + filesystem::path(path).filename().string());
+	filesystem::copy_file(path, copy, filesystem::copy_options::overwrite_existing);
+	const string source = copy.string();
+	MipCache cache(source, COMPRESSION_NONE);
+
+	TextureOptions levelZero;
+	levelZero.mipmaps = MIPMAP_GPU;
+	TextureImage base = TextureImage::load(source, levelZero);
+	double decodeMs = bestOf(runs, [&]() { base = TextureImage::load(source, levelZero); });
+
+	vector<unsigned char> reference;
+	double scalarMs = bestOf(runs, [&]() { reference = buildScalar(base.mips); });
+
+	MipChain chain = base.mips;
+	double buildMs = bestOf(runs, [&]() {
+		chain = base.mips;
+		chain.buildLevels();
+	});
+
+	bool stored = true;
+	double storeMs = bestOf(runs, [&]() { stored = cache.store(chain) && stored; });
+	bool hit = true;
+	double loadMs = bestOf(runs, [&]() { hit = cache.load().has_value() && hit; });
+
+	const MipLevel &top = chain.getLevel(0);
+	const uintmax_t bmpBytes = filesystem::file_size(source);
+	cout << path << " (" << top.width << "x" << top.height << (chain.getChannels() == 4 ? " BGRA" : " BGR")
+		<< ", " << chain.getLevelCount() << " levels, BMP " << bmpBytes / 1024 << " KiB, chain "
+		<< chain.getPixelBytes() / 1024 << " KiB)\n"
+		<< "  BMP decode:        " << decodeMs << " ms\n"
+		<< "  scalar box filter: " << scalarMs << " ms\n"
+		<< "  MipChain (" << MipKernels::getInstructionSet() << "):" << string(6 - min<size_t>(6, string(MipKernels::getInstructionSet()).size()), ' ')
+		<< buildMs << " ms, " << scalarMs / buildMs << "x\n"
+		<< "  cache store:       " << storeMs << " ms\n"
+		<< "  cache load:        " << loadMs << " ms (mapped, read during the upload), against "
+		<< decodeMs + buildMs << " ms decode + build\n";
+
+	filesystem::remove(cache.getPath());
+	filesystem::remove(copy);
+
+	bool ok = true;
+	if (reference.size() != chain.getPixelBytes() || !equal(reference.begin(), reference.end(), chain.getPixelData())) {
+		cerr << "  levels differ from the scalar filter" << endl;
+		ok = false;
+	}
+	if (!stored || !hit) {
+		cerr << "  cache round trip failed" << endl;
+		ok = false;
+	}
+	return ok;
+}
+
+int main(int argc, char *argv[]) {
+	vector<string> paths;
+	for (int i = 1; i < argc; i++) {
+		paths.push_back(argv[i]);
+	}
+	if (paths.empty()) {
+		for (const filesystem::directory_entry &entry : filesystem::directory_iterator("textureSources")) {
+			if (entry.path().extension() == ".bmp") {
+				paths.push_back(entry.path().string());
+			}
+		}
+		sort(paths.begin(), paths.end());
+	}
+
+	const int runs = 10;
+	bool ok = true;
+	for (const string &path : paths) {
+		try {
+			ok = benchImage(path, runs) && ok;
+		} catch (const exception &e) {
+			// e.g. textureSources/test.bmp, which is empty on purpose
+			cerr << path << " skipped: " << e.what() << endl;
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/**
+* @file benchOBJScanner.cpp
+* @brief Microbenchmark: OBJScanner against the former istringstream/stoul path.
+*
+* Both decoders run over the same in-memory file and must produce the same
+* checksum. Only number decoding is measured, line splitting is identical.
+*
+* Usage: ./bench_scanner [file.obj ...]   (defaults to teapot.obj and zombie.obj)
+*/
+
+#include "../src/modelLoader/OBJScanner.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+struct Checksum {
+	double floatSum = 0.0;
+	unsigned long long indexSum = 0;
+	size_t numbers = 0;
+
+	bool operator==(const Checksum &other) const {
+		return floatSum == other.floatSum && indexSum == other.indexSum && numbers == other.numbers;
+	}
+};
+
+static vector<string_view> splitLines(const string &text) {
+	vector<string_view> lines;
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t eol = text.find('\n', start);
+		if (eol == string::npos) {
+			eol = text.size();
+		}
+		lines.emplace_back(text.data() + start, eol - start);
+		start = eol + 1;
+	}
+	return lines;
+}
+
+// former loader path: istringstream for floats, substr + stoul for indices
+
+static array<string, 3> getTokenValues(const string &token) {
+	array<string, 3> tokenValues = {"", "", ""};
+
+	size_t slash = token.find('/');
+	if (slash == string::npos) {
+		tokenValues[0] = token;
+		return tokenValues;
+	}
+
+	size_t slash2 = token.find('/', slash + 1);
+	tokenValues[0] = token.substr(0, slash);
+	if (slash2 == string::npos) {
+		tokenValues[1] = token.substr(slash + 1);
+	} else {
+		tokenValues[1] = token.substr(slash + 1, slash2 - slash - 1);
+		tokenValues[2] = token.substr(slash2 + 1);
+	}
+	return tokenValues;
+}
+
+static Checksum decodeStream(const vector<string_view> &lines) {
+	Checksum sum;
+	string type, token;
+	float x, y, z;
+
+	for (string_view line : lines) {
+		istringstream sline{string(line)};
+		type.clear();
+		sline >> type;
+		if (type == "v" || type == "vn") {
+			sline >> x >> y >> z;
+			sum.floatSum += x + y + z;
+			sum.numbers += 3;
+		} else if (type == "vt") {
+			sline >> x >> y;
+			sum.floatSum += x + y;
+			sum.numbers += 2;
+		} else if (type == "f") {
+			while (sline >> token) {
+				for (const string &value : getTokenValues(token)) {
+					if (!value.empty()) {
+						sum.indexSum += stoul(value) - 1;
+						sum.numbers++;
+					}
+				}
+			}
+		}
+	}
+	return sum;
+}
+
+// OBJScanner path
+
+static Checksum decodeScanner(const vector<string_view> &lines) {
+	Checksum sum;
+	GLfloat values[3];
+
+	for (string_view line : lines) {
+		const char *end = line.data() + line.size();
+		const char *p = OBJScanner::skipBlanks(line.data(), end);
+		const char *typeEnd = OBJScanner::findBlank(p, end);
+		string_view type(p, typeEnd - p);
+
+		if (type == "v" || type == "vn") {
+			OBJScanner::scanFloats(typeEnd, end, values, 3);
+			sum.floatSum += values[0] + values[1] + values[2];
+			sum.numbers += 3;
+		} else if (type == "vt") {
+			OBJScanner::scanFloats(typeEnd, end, values, 2);
+			sum.floatSum += values[0] + values[1];
+			sum.numbers += 2;
+		} else if (type == "f") {
+			for (p = OBJScanner::skipBlanks(typeEnd, end); p != end; p = OBJScanner::skipBlanks(p, end)) {
+				const char *tokenEnd = OBJScanner::findBlank(p, end);
+				FaceVertex corner;
+				OBJScanner::scanFaceVertex(p, tokenEnd, corner);
+				for (int k = 0; k < 3; k++) {
+					if (corner.has[k]) {
+						sum.indexSum += corner.idx[k];
+						sum.numbers++;
+					}
+				}
+				p = tokenEnd;
+			}
+		}
+	}
+	return sum;
+}
+
+template <typename Decoder>
+static double bestOf(int runs, Decoder decode, Checksum &result) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		auto start = chrono::steady_clock::now();
+		result = decode();
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		best = min(best, elapsed.count());
+	}
+	return best;
+}
+
+int main(int argc, char *argv[]) {
+	vector<string> paths;
+	for (int i = 1; i < argc; i++) {
+		paths.push_back(argv[i]);
+	}
+	if (paths.empty()) {
+		paths = {"models/teapot.obj", "models/zombie.obj"};
+	}
+
+	const int runs = 10;
+	bool ok = true;
+
+	for (const string &path : paths) {
+		ifstream file(path, ios::binary);
+		if (!file) {
+			cerr << "Cannot open " << path << endl;
+			return 1;
+		}
+		ostringstream content;
+		content << file.rdbuf();
+		string text = content.str();
+		vector<string_view> lines = splitLines(text);
+
+		Checksum streamSum, scannerSum;
+		double streamMs = bestOf(runs, [&]() { return decodeStream(lines); }, streamSum);
+		double scannerMs = bestOf(runs, [&]() { return decodeScanner(lines); }, scannerSum);
+
+		double megabytes = text.size() / (1024.0 * 1024.0);
+		cout << path << " (" << lines.size() << " lines, " << streamSum.numbers << " numbers)\n"
+			<< "  istringstream/stoul: " << streamMs << " ms, " << megabytes / (streamMs / 1000.0) << " MB/s\n"
+			<< "  OBJScanner:          " << scannerMs << " ms, " << megabytes / (scannerMs / 1000.0) << " MB/s\n"
+			<< "  speedup:             " << streamMs / scannerMs << "x\n";
+
+		if (!(streamSum == scannerSum)) {
+			cerr << "  checksum mismatch between decoders" << endl;
+			ok = false;
+		}
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+/**
+* @file benchQOI.cpp
+* @brief Benchmark: QOI against BMP for the textures, file size and load time.
+*
+* Every BMP is converted to QOI in the temp directory. Both files are then
+* loaded with TextureImage::load() (level 0 only, as `--mipmaps gpu` does)
+* until the pixels are in memory and hashed, which is everything before
+* the upload. The upload itself takes the same bytes for both formats, the
+* viewer prints its time for the command line texture.
+*
+* Loads are timed warm (files in the page cache, best of `--runs`) and
+* cold: before each cold run the files are synced and dropped from the
+* page cache with posix_fadvise(), so they are read from the disk. Cold
+* numbers need a temp directory on a disk (not tmpfs), see TMPDIR. From
+* the warm times and the sizes the disk bandwidth is derived below which
+* the smaller QOI file makes up for its decoding; a BMP costs only its
+* mapping and hash.
+*
+* Usage: ./bench_qoi [--runs N] [image.bmp ...]   (defaults to every .bmp in textureSources)
+*/
+
+#include "../src/texture/QOILoader.hpp"
+#include "../src/texture/TextureImage.hpp"
+#include "../src/texture/MipChain.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>  // open(), posix_fadvise()
+#include <unistd.h> // fdatasync(), close()
+
+using namespace std;
+
+struct ImageResult {
+	uintmax_t bmpBytes = 0;
+	uintmax_t qoiBytes = 0;
+	double encodeMs = 0;
+	double bmpWarmMs = 0;
+	double qoiWarmMs = 0;
+	double bmpColdMs = 0;
+	double qoiColdMs = 0;
+};
+
+// writes back and evicts the cached pages of `path`
+static void dropFromPageCache(const string &path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+template <typename Work>
+static double bestOf(int runs, Work work) {
+	double best = 1e30;
+	for (int i = 0; i < runs; i++) {
+		auto start = chrono::steady_clock::now();
+		work();
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		best = min(best, elapsed.count());
+	}
+	return best;
+}
+
+template <typename Work>
+static double medianCold(int runs, const string &path, Work work) {
+	vector<double> samples;
+	for (int i = 0; i < runs; i++) {
+		dropFromPageCache(path);
+		auto start = chrono::steady_clock::now();
+		work();
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		samples.push_back(elapsed.count());
+	}
+	sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+static ImageResult benchImage(const string &path, int runs) {
+	const filesystem::path stem = filesystem::temp_directory_path() / ("scop_bench_" + filesystem::path(path).stem().string());
+	const string bmpPath = stem.string() + ".bmp";
+	const string qoiPath = stem.string() + ".qoi";
+	filesystem::copy_file(path, bmpPath, filesystem::copy_options::overwrite_existing);
+
+	TextureOptions levelZero;
+	levelZero.mipmaps = MIPMAP_GPU;
+	ImageResult result;
+	try {
+		const TextureImage source = TextureImage::load(bmpPath, levelZero);
+		vector<unsigned char> encoded;
+		result.encodeMs = bestOf(runs, [&]() { encoded = QOIEncoder::encode(source.mips); });
+		ofstream file(qoiPath, ios::binary | ios::trunc);
+		file.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+		file.close();
+		if (!file) {
+			throw runtime_error("cannot write " + qoiPath);
+		}
+
+		const TextureImage decoded = TextureImage::load(qoiPath, levelZero);
+		if (decoded.contentHash != source.contentHash || decoded.mips.getPixelBytes() != source.mips.getPixelBytes()
+			|| memcmp(decoded.mips.getPixelData(), source.mips.getPixelData(), source.mips.getPixelBytes()) != 0) {
+			throw runtime_error("QOI round trip changed the pixels");
+		}
+
+		result.bmpBytes = filesystem::file_size(bmpPath);
+		result.qoiBytes = filesystem::file_size(qoiPath);
+		result.bmpWarmMs = bestOf(runs, [&]() { TextureImage::load(bmpPath, levelZero); });
+		result.qoiWarmMs = bestOf(runs, [&]() { TextureImage::load(qoiPath, levelZero); });
+		result.bmpColdMs = medianCold(runs, bmpPath, [&]() { TextureImage::load(bmpPath, levelZero); });
+		result.qoiColdMs = medianCold(runs, qoiPath, [&]() { TextureImage::load(qoiPath, levelZero); });
+	} catch (...) {
+		filesystem::remove(bmpPath);
+		filesystem::remove(qoiPath);
+		throw;
+	}
+	filesystem::remove(bmpPath);
+	filesystem::remove(qoiPath);
+	return result;
+}
+
+static void printRow(const string &name, const ImageResult &r) {
+	cout << name << ": BMP " << r.bmpBytes / 1024 << " KiB, QOI " << r.qoiBytes / 1024 << " KiB ("
+		<< 100.0 * r.qoiBytes / max<uintmax_t>(r.bmpBytes, 1) << "%), encode " << r.encodeMs << " ms\n"
+		<< "  load warm: BMP " << r.bmpWarmMs << " ms, QOI " << r.qoiWarmMs << " ms\n"
+		<< "  load cold: BMP " << r.bmpColdMs << " ms, QOI " << r.qoiColdMs << " ms\n";
+
+	// reading the bytes QOI saves must take longer than decoding it for QOI to win
+	const double savedBytes = double(r.bmpBytes) - double(r.qoiBytes);
+	const double decodeCostMs = r.qoiWarmMs - r.bmpWarmMs;
+	if (savedBytes > 0 && decodeCostMs > 0) {
+		cout << "  QOI loads faster below " << savedBytes / (decodeCostMs / 1000.0) / (1024 * 1024)
+			<< " MiB/s of disk bandwidth\n";
+	}
+}
+
+int main(int argc, char *argv[]) {
+	int runs = 5;
+	vector<string> paths;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--runs" && i + 1 < argc) {
+			runs = max(1, atoi(argv[++i]));
+		} else if (arg[0] != '-') {
+			paths.push_back(arg);
+		} else {
+			cerr << "Usage: ./bench_qoi [--runs N] [image.bmp ...]" << endl;
+			return 1;
+		}
+	}
+	if (paths.empty()) {
+		for (const filesystem::directory_entry &entry : filesystem::directory_iterator("textureSources")) {
+			if (entry.path().extension() == ".bmp") {
+				paths.push_back(entry.path().string());
+			}
+		}
+		sort(paths.begin(), paths.end());
+	}
+
+	ImageResult total;
+	size_t images = 0;
+	bool ok = true;
+	for (const string &path : paths) {
+		try {
+			ImageResult result = benchImage(path, runs);
+			printRow(path, result);
+			total.bmpBytes += result.bmpBytes;
+			total.qoiBytes += result.qoiBytes;
+			total.encodeMs += result.encodeMs;
+			total.bmpWarmMs += result.bmpWarmMs;
+			total.qoiWarmMs += result.qoiWarmMs;
+			total.bmpColdMs += result.bmpColdMs;
+			total.qoiColdMs += result.qoiColdMs;
+			images++;
+		} catch (const QOILoaderException &e) {
+			cerr << path << ": " << e.what() << endl;
+			ok = false;
+		} catch (const exception &e) {
+			// e.g. textureSources/test.bmp, which is empty on purpose
+			cerr << path << " skipped: " << e.what() << endl;
+		}
+	}
+	if (images > 1) {
+		printRow("total (" + to_string(images) + " images)", total);
+	}
+	return ok ? 0 : 1;
+}
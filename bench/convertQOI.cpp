@@ -0,0 +1,67 @@
+/**
+* @file convertQOI.cpp
+* @brief Converts BMP textures to QOI, losslessly.
+*
+* Every image is written next to its source with the extension replaced
+* (`wood.bmp` -> `wood.qoi`) and read back to check that the pixels
+* survived. The viewer and the .mtl files take either format.
+*
+* Usage: ./toqoi image.bmp ...
+*/
+
+#include "../src/texture/QOILoader.hpp"
+#include "../src/texture/TextureImage.hpp"
+#include "../src/texture/MipChain.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+static void convertImage(const string &path) {
+	TextureOptions levelZero;
+	levelZero.mipmaps = MIPMAP_GPU;
+	const TextureImage image = TextureImage::load(path, levelZero);
+	const vector<unsigned char> encoded = QOIEncoder::encode(image.mips);
+
+	const string target = filesystem::path(path).replace_extension(".qoi").string();
+	ofstream file(target, ios::binary | ios::trunc);
+	file.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+	file.close();
+	if (!file) {
+		throw runtime_error("cannot write " + target);
+	}
+
+	const MipChain decoded = QOILoader(target).takeImage();
+	if (decoded.getPixelBytes() != image.mips.getPixelBytes()
+		|| memcmp(decoded.getPixelData(), image.mips.getPixelData(), decoded.getPixelBytes()) != 0) {
+		throw runtime_error(target + " does not decode to the source pixels");
+	}
+
+	const uintmax_t sourceBytes = filesystem::file_size(path);
+	cout << target << ": " << sourceBytes / 1024 << " KiB -> " << encoded.size() / 1024 << " KiB ("
+		<< 100.0 * encoded.size() / sourceBytes << "%)" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		cerr << "Usage: ./toqoi image.bmp ..." << endl;
+		return 1;
+	}
+
+	bool ok = true;
+	for (int i = 1; i < argc; i++) {
+		try {
+			convertImage(argv[i]);
+		} catch (const exception &e) {
+			cerr << argv[i] << ": " << e.what() << endl;
+			ok = false;
+		}
+	}
+	return ok ? 0 : 1;
+}
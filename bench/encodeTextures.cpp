@@ -0,0 +1,127 @@
+/**
+* @file encodeTextures.cpp
+* @brief Offline texture encoder: writes the .scoptex caches the viewer
+* reads, so it never pays for filtering or block compression itself.
+*
+* Each image is decoded, its mip chain built and, unless `--format none`,
+* block compressed; the result goes to `image.bmp.scoptex`, keyed like
+* the caches the viewer writes, so `./scop ... --compress bc7` hits it.
+* Printed per image: sizes, encode time and the PSNR of level 0 against
+* the source.
+*
+* Usage: ./scoptex [--format bc1|bc7|none] image.bmp ...   (default bc7)
+*/
+
+#include "../src/texture/MipChain.hpp"
+#include "../src/texture/MipCache.hpp"
+#include "../src/texture/TextureImage.hpp"
+#include "../src/texture/TextureEncoder.hpp"
+#include "../src/jobs/JobSystem.hpp"
+#include "../src/ResourcePath.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <iterator>
+#include <cstdint>
+
+using namespace std;
+
+static const char *FORMAT_NAMES[] = {"none", "bc1", "bc7"};
+
+static int usage() {
+	cerr << "Usage: ./scoptex [--format bc1|bc7|none] image.bmp ..." << endl;
+	return 1;
+}
+
+// PSNR of the RGB channels of level 0, in dB; infinite when identical
+static double measurePSNR(const MipChain &source, const MipChain &encoded) {
+	const MipChain decoded = TextureEncoder::decode(encoded);
+	const MipLevel &level = source.getLevel(0);
+	const uint32_t sourceChannels = source.getChannels(), decodedChannels = decoded.getChannels();
+	const size_t sourceRow = MipChain::getRowBytes(level.width, sourceChannels);
+	const size_t decodedRow = MipChain::getRowBytes(level.width, decodedChannels);
+
+	double squaredError = 0;
+	for (uint32_t y = 0; y < level.height; y++) {
+		const unsigned char *a = source.getLevelData(0) + y * sourceRow;
+		const unsigned char *b = decoded.getLevelData(0) + y * decodedRow;
+		for (uint32_t x = 0; x < level.width; x++) {
+			for (uint32_t k = 0; k < 3; k++) {
+				const double d = double(a[x * sourceChannels + k]) - double(b[x * decodedChannels + k]);
+				squaredError += d * d;
+			}
+		}
+	}
+	const double mse = squaredError / (3.0 * level.width * level.height);
+	return (mse == 0) ? INFINITY : 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+static void encodeImage(const string &path, TextureCompression compression) {
+	TextureOptions levelZero;
+	levelZero.mipmaps = MIPMAP_GPU;
+	const TextureImage image = TextureImage::load(path, levelZero);
+
+	auto start = chrono::steady_clock::now();
+	MipChain levels = image.mips;
+	levels.buildLevels();
+	auto built = chrono::steady_clock::now();
+	const MipChain encoded = TextureEncoder::encode(levels, compression);
+	auto done = chrono::steady_clock::now();
+
+	// where TextureImage::load() looks for it
+	MipCache cache(ResourcePath::getPath(path), compression);
+	if (!cache.store(encoded)) {
+		throw runtime_error("cannot write " + cache.getPath());
+	}
+
+	const MipLevel &base = encoded.getLevel(0);
+	cout << cache.getPath() << ": " << base.width << "x" << base.height << ", " << encoded.getLevelCount()
+		<< " levels, " << FORMAT_NAMES[compression] << ", " << levels.getPixelBytes() / 1024 << " KiB -> "
+		<< encoded.getPixelBytes() / 1024 << " KiB"
+		<< ", mips " << chrono::duration<double, milli>(built - start).count() << " ms"
+		<< ", encode " << chrono::duration<double, milli>(done - built).count() << " ms"
+		<< ", PSNR " << measurePSNR(levels, encoded) << " dB" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	TextureCompression compression = COMPRESSION_BC7;
+	vector<string> paths;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc) {
+			string format = argv[++i];
+			size_t k = 0;
+			while (k < size(FORMAT_NAMES) && format != FORMAT_NAMES[k]) {
+				k++;
+			}
+			if (k == size(FORMAT_NAMES)) {
+				return usage();
+			}
+			compression = static_cast<TextureCompression>(k);
+		} else if (arg[0] != '-') {
+			paths.push_back(arg);
+		} else {
+			return usage();
+		}
+	}
+	if (paths.empty()) {
+		return usage();
+	}
+
+	cout << "Encoding on " << JobSystem::getShared().getWorkerCount() + 1 << " threads" << endl;
+	bool ok = true;
+	for (const string &path : paths) {
+		try {
+			encodeImage(path, compression);
+		} catch (const exception &e) {
+			cerr << path << ": " << e.what() << endl;
+			ok = false;
+		}
+	}
+	return ok ? 0 : 1;
+}
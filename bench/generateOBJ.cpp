@@ -0,0 +1,82 @@
+/**
+* @file generateOBJ.cpp
+* @brief Command line front end of OBJGenerator.
+*
+* Usage: ./gen_obj [--shape grid|sphere] [--triangles N] [--polygon N]
+*                  [--fields v|v/vt|v//vn|v/vt/vn] out.obj
+*/
+
+#include "OBJGenerator.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+
+static int usage() {
+	cerr << "Usage: ./gen_obj [--shape grid|sphere] [--triangles N] [--polygon N]\n"
+		<< "                 [--fields v|v/vt|v//vn|v/vt/vn] out.obj\n"
+		<< "  --polygon  corners per face: 3 (default) or an even number >= 4\n";
+	return 1;
+}
+
+static bool parseFields(const string &fields, OBJGeneratorOptions &options) {
+	if (fields != "v" && fields != "v/vt" && fields != "v//vn" && fields != "v/vt/vn") {
+		return false;
+	}
+	options.texCoords = (fields.find("vt") != string::npos);
+	options.normals = (fields.find("vn") != string::npos);
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	OBJGeneratorOptions options;
+	string path;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+
+		if (arg == "--shape" && hasValue) {
+			string shape = argv[++i];
+			if (shape != "grid" && shape != "sphere") {
+				return usage();
+			}
+			options.shape = (shape == "sphere") ? OBJGeneratorOptions::SPHERE : OBJGeneratorOptions::GRID;
+		} else if (arg == "--triangles" && hasValue) {
+			options.triangles = strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--polygon" && hasValue) {
+			options.polygonSize = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+		} else if (arg == "--fields" && hasValue) {
+			if (!parseFields(argv[++i], options)) {
+				return usage();
+			}
+		} else if (arg[0] != '-' && path.empty()) {
+			path = arg;
+		} else {
+			return usage();
+		}
+	}
+
+	if (path.empty() || !OBJGenerator::isValidPolygonSize(options.polygonSize)) {
+		return usage();
+	}
+
+	ofstream file(path, ios::binary);
+	if (!file) {
+		cerr << "Cannot open " << path << endl;
+		return 1;
+	}
+
+	OBJGeneratorStats stats = OBJGenerator::write(file, options);
+	file.close();
+	if (!file) {
+		cerr << "Cannot write " << path << endl;
+		return 1;
+	}
+
+	cout << path << ": " << stats.vertices << " vertices, " << stats.faces << " faces, "
+		<< stats.triangles << " triangles, " << stats.bytes / (1024 * 1024) << " MiB\n";
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "MappedFile.hpp"
+#include <exception>
+#include <string>
+#include <utility>
+#include <fcntl.h>    // open()
+#include <unistd.h>   // close()
+#include <sys/mman.h> // mmap(), madvise()
+#include <sys/stat.h> // fstat()
+
+using namespace std;
+
+MappedFileException::MappedFileException(ErrorCode err)
+	: _errorCode(err) {}
+
+const char *MappedFileException::what() const noexcept {
+	switch (_errorCode) {
+		case CANNOT_OPEN: return "File cannot be opened for mapping";
+		case CANNOT_MAP: return "File cannot be mapped into memory";
+		default: return "An unknown error occurred during file mapping";
+	}
+}
+
+MappedFileException::ErrorCode MappedFileException::getErrorCode() const {
+	return _errorCode;
+}
+
+
+MappedFile::MappedFile(const string &path) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw MappedFileException(MappedFileException::CANNOT_OPEN);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		throw MappedFileException(MappedFileException::CANNOT_MAP);
+	}
+
+	_size = static_cast<size_t>(st.st_size);
+	if (_size == 0) {
+		close(fd);
+		return;
+	}
+
+	void *data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	close(fd);
+	if (data == MAP_FAILED) {
+		_size = 0;
+		throw MappedFileException(MappedFileException::CANNOT_MAP);
+	}
+	_data = data;
+
+	// Loaders scan front to back, let the kernel read ahead aggressively
+	madvise(_data, _size, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+	: _data(exchange(other._data, nullptr)), _size(exchange(other._size, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+	if (this != &other) {
+		unmap();
+		_data = exchange(other._data, nullptr);
+		_size = exchange(other._size, 0);
+	}
+	return *this;
+}
+
+// getters //
+
+const char *MappedFile::data() const {
+	return static_cast<const char *>(_data);
+}
+
+size_t MappedFile::size() const {
+	return _size;
+}
+
+// private //
+
+void MappedFile::unmap() {
+	if (_data) {
+		munmap(_data, _size);
+		_data = nullptr;
+		_size = 0;
+	}
+}
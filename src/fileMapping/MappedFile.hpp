@@ -0,0 +1,65 @@
+/**
+* @file MappedFile.hpp
+* @brief Read-only memory mapping of a whole file.
+*
+* Wraps mmap()/munmap() so loaders can scan file contents in place
+* instead of copying them through stream buffers.
+*/
+
+#pragma once
+
+#include <exception>
+#include <string>
+#include <cstddef>
+
+/**
+* @class MappedFileException
+* @brief Exception type used for file mapping errors.
+*/
+class MappedFileException : public std::exception {
+public:
+	enum ErrorCode {
+		CANNOT_OPEN,
+		CANNOT_MAP,
+	};
+
+	explicit MappedFileException(ErrorCode err);
+	const char *what() const noexcept override;
+
+	ErrorCode getErrorCode() const;
+
+private:
+	ErrorCode _errorCode;
+};
+
+/**
+* @class MappedFile
+* @brief Owns a read-only, private mapping of a regular file.
+*
+* The mapping lives as long as the object. An empty file is valid and
+* yields a null data pointer with size 0.
+*
+* Throws MappedFileException if the file cannot be opened or is not a
+* regular file that can be mapped (pipes, directories, ...).
+*/
+class MappedFile {
+public:
+	explicit MappedFile(const std::string &path);
+	~MappedFile();
+
+	MappedFile(MappedFile &&other) noexcept;
+	MappedFile &operator=(MappedFile &&other) noexcept;
+
+	const char *data() const;
+	size_t size() const;
+
+private:
+	void *_data = nullptr;
+	size_t _size = 0;
+
+	void unmap();
+
+	MappedFile();
+	MappedFile(const MappedFile &other);
+	MappedFile &operator=(const MappedFile &other);
+};
@@ -0,0 +1,96 @@
+#include "FileWatcher.hpp"
+#include <string>
+#include <filesystem>
+#include <unistd.h>     // read(), close()
+#include <sys/stat.h>   // stat()
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+
+FileWatcher::FileWatcher(const string &path)
+	: _path(path)
+{
+	filesystem::path file(path);
+	_name = file.filename().string();
+
+#ifdef __linux__
+	string directory = file.parent_path().string();
+	if (directory.empty()) {
+		directory = ".";
+	}
+
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_fd >= 0 && inotify_add_watch(_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(_fd);
+		_fd = -1;
+	}
+#endif
+
+	// the stat() baseline, also used when inotify is not available
+	statChanged();
+}
+
+FileWatcher::~FileWatcher() {
+	if (_fd >= 0) {
+		close(_fd);
+	}
+}
+
+/**
+* @brief True if the file was rewritten since the last call.
+*/
+bool FileWatcher::hasChanged() {
+	if (_fd >= 0) {
+		return readEvents();
+	}
+	return statChanged();
+}
+
+// private //
+
+/**
+* @brief Drains the pending inotify events of the directory and looks for
+* ones about the watched file. A queue overflow counts as a change.
+*/
+bool FileWatcher::readEvents() {
+#ifdef __linux__
+	alignas(struct inotify_event) char buffer[4096];
+	bool changed = false;
+
+	for (;;) {
+		ssize_t length = read(_fd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			// EAGAIN: nothing left to read
+			return changed;
+		}
+
+		for (ssize_t offset = 0; offset < length;) {
+			const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+			if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && _name == event->name)) {
+				changed = true;
+			}
+			offset += sizeof(struct inotify_event) + event->len;
+		}
+	}
+#else
+	return false;
+#endif
+}
+
+/**
+* @brief Compares modification time and size with the last call. A file
+* that is missing for a moment (replaced by a rename) is not a change.
+*/
+bool FileWatcher::statChanged() {
+	struct stat st;
+	if (stat(_path.c_str(), &st) != 0) {
+		return false;
+	}
+
+	bool changed = (_size >= 0) && (st.st_mtime != _modified || st.st_size != _size);
+	_modified = st.st_mtime;
+	_size = st.st_size;
+	return changed;
+}
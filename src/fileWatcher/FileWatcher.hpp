@@ -0,0 +1,45 @@
+/**
+* @file FileWatcher.hpp
+* @brief Notices when a file on disk is rewritten.
+*
+* On Linux the parent directory is watched with inotify, so both in place
+* writes and the write-then-rename of most exporters are seen. Elsewhere,
+* or when inotify is not available, the file is stat()ed on every poll.
+*/
+
+#pragma once
+
+#include <string>
+#include <ctime>
+#include <sys/types.h>
+
+/**
+* @class FileWatcher
+* @brief Polled, non-blocking change detection for one file.
+*
+* hasChanged() is meant to be called once per frame. It reports a change
+* once, after the writer closed the file or renamed it into place, so a
+* reload does not start on a half written file.
+*/
+class FileWatcher {
+public:
+	explicit FileWatcher(const std::string &path);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher &other) = delete;
+	FileWatcher &operator=(const FileWatcher &other) = delete;
+
+	bool hasChanged();
+
+private:
+	std::string _path;
+	std::string _name;  // file name inside the watched directory
+	int _fd = -1;       // inotify instance, -1 when polling stat()
+	time_t _modified = 0;
+	off_t _size = -1;
+
+	bool readEvents();
+	bool statChanged();
+
+	FileWatcher();
+};
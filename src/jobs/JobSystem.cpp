@@ -0,0 +1,129 @@
+#include "JobSystem.hpp"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+// the pool and queue of the current thread if it is a worker
+static thread_local const JobSystem *currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+JobSystem::JobSystem(unsigned workerCount) {
+	for (unsigned i = 0; i <= workerCount; i++) {
+		_queues.push_back(make_unique<WorkQueue>());
+	}
+	for (unsigned i = 0; i < workerCount; i++) {
+		_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		lock_guard<mutex> lock(_sleepMutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (thread &worker : _workers) {
+		worker.join();
+	}
+}
+
+/**
+* @brief Process-wide pool with one worker per additional hardware thread;
+* the thread calling parallelFor() is the last one.
+*/
+JobSystem &JobSystem::getShared() {
+	static JobSystem shared(max(thread::hardware_concurrency(), 1u) - 1);
+	return shared;
+}
+
+unsigned JobSystem::getWorkerCount() const {
+	return static_cast<unsigned>(_workers.size());
+}
+
+// private //
+
+size_t JobSystem::getQueueIndex() const {
+	return (currentPool == this) ? currentQueue : _workers.size();
+}
+
+void JobSystem::submit(Job job) {
+	{
+		WorkQueue &queue = *_queues[getQueueIndex()];
+		lock_guard<mutex> lock(queue.mutex);
+		queue.jobs.push_back(move(job));
+	}
+	{
+		lock_guard<mutex> lock(_sleepMutex);
+		_queued.fetch_add(1, memory_order_release);
+	}
+	_wake.notify_one();
+}
+
+/**
+* @brief Runs one job: the newest of the own queue, else the oldest of
+* the next non-empty queue.
+* @return false if every queue was empty.
+*/
+bool JobSystem::runOne() {
+	const size_t own = getQueueIndex();
+	const size_t queueCount = _queues.size();
+	Job job;
+
+	for (size_t i = 0; i < queueCount && !job; i++) {
+		WorkQueue &queue = *_queues[(own + i) % queueCount];
+		lock_guard<mutex> lock(queue.mutex);
+		if (queue.jobs.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			job = move(queue.jobs.back());
+			queue.jobs.pop_back();
+		} else {
+			job = move(queue.jobs.front());
+			queue.jobs.pop_front();
+		}
+	}
+	if (!job) {
+		return false;
+	}
+
+	_queued.fetch_sub(1, memory_order_acq_rel);
+	job();
+	return true;
+}
+
+/**
+* @brief Helps with queued jobs until every job of `group` finished.
+*/
+void JobSystem::wait(const JobGroup &group) {
+	while (group.remaining.load(memory_order_acquire) > 0) {
+		if (!runOne()) {
+			this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::workerLoop(size_t index) {
+	currentPool = this;
+	currentQueue = index;
+
+	while (true) {
+		if (runOne()) {
+			continue;
+		}
+
+		unique_lock<mutex> lock(_sleepMutex);
+		_wake.wait(lock, [this]() { return _stop || _queued.load(memory_order_acquire) > 0; });
+		if (_stop) {
+			return;
+		}
+	}
+}
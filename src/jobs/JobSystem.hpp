@@ -0,0 +1,116 @@
+/**
+* @file JobSystem.hpp
+* @brief Small work-stealing thread pool for data-parallel loops.
+*
+* Every worker owns a queue; it takes work from the back of its own
+* queue and, when that is empty, steals from the front of the others.
+* Threads that are not workers (the main thread) submit into a shared
+* queue and help running jobs while they wait, so a parallelFor() never
+* blocks a thread that could do work, and nested loops cannot deadlock.
+*
+* With zero workers everything runs on the calling thread.
+*/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+class JobSystem {
+public:
+	using Job = std::function<void()>;
+
+	explicit JobSystem(unsigned workerCount);
+	~JobSystem();
+
+	JobSystem(const JobSystem &other) = delete;
+	JobSystem &operator=(const JobSystem &other) = delete;
+
+	static JobSystem &getShared();
+
+	unsigned getWorkerCount() const;
+
+	/**
+	* @brief Calls body(begin, end) over [0, count) in ranges of `grain`
+	* elements and returns when all ranges are done.
+	*
+	* Ranges run in any order on any thread, the calling one included.
+	* If ranges throw, the exception of the lowest range is rethrown here
+	* after the others finished, the same one a serial loop would report.
+	*/
+	template <typename Body>
+	void parallelFor(size_t count, size_t grain, Body &&body);
+
+private:
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	struct JobGroup {
+		std::atomic<size_t> remaining{0};
+		std::mutex errorMutex;
+		std::exception_ptr error;
+		size_t errorRange = SIZE_MAX;
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> _queues;  // one per worker, then the shared one
+	std::vector<std::thread> _workers;
+	std::mutex _sleepMutex;
+	std::condition_variable _wake;
+	std::atomic<size_t> _queued{0};
+	bool _stop = false;
+
+	size_t getQueueIndex() const;
+	void submit(Job job);
+	bool runOne();
+	void wait(const JobGroup &group);
+	void workerLoop(size_t index);
+
+	JobSystem();
+};
+
+template <typename Body>
+void JobSystem::parallelFor(size_t count, size_t grain, Body &&body) {
+	grain = std::max<size_t>(grain, 1);
+	const size_t ranges = (count + grain - 1) / grain;
+	if (ranges <= 1 || _workers.empty()) {
+		for (size_t begin = 0; begin < count; begin += grain) {
+			body(begin, std::min(begin + grain, count));
+		}
+		return;
+	}
+
+	JobGroup group;
+	group.remaining = ranges;
+	for (size_t range = 0; range < ranges; range++) {
+		submit([&group, &body, range, grain, count]() {
+			size_t begin = range * grain;
+			try {
+				body(begin, std::min(begin + grain, count));
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(group.errorMutex);
+				if (range < group.errorRange) {
+					group.errorRange = range;
+					group.error = std::current_exception();
+				}
+			}
+			group.remaining.fetch_sub(1, std::memory_order_acq_rel);
+		});
+	}
+	wait(group);
+
+	if (group.error) {
+		std::rethrow_exception(group.error);
+	}
+}
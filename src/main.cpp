@@ -1,12 +1,26 @@
 #include <iostream>
 #include <exception>
 #include <vector>
+#include <utility>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 #include "modelLoader/RenderModelLoader.hpp"
+#include "modelLoader/AsyncModelLoader.hpp"
+#include "fileWatcher/FileWatcher.hpp"
 #include "window/Window.hpp"
 #include "shaders/ShaderProgram.hpp"
-#include "texture/Texture.hpp"
+#include "texture/TextureCache.hpp"
+#include "texture/TextureImage.hpp"
+#include "texture/MipChain.hpp"
+#include "texture/BMPLoader.hpp"
+#include "texture/QOILoader.hpp"
+#include "materialLoader/MaterialLibrary.hpp"
 #include "render/Render.hpp"
 #include "scene/Transformation.hpp"
 #include "scene/Material.hpp"
@@ -17,17 +31,121 @@ using namespace std;
 
 double prevTime = glfwGetTime();
 
+// called once continueUpload() has every texture of `materials` on the GPU; materials without map_Kd show their Kd color
+static void applyMaterials(Render &render, TextureCache &textures, const MaterialSet &materials, const MaterialBinding &fallback,
+    size_t fallbackHash) {
+    unordered_map<string, MaterialBinding> bindings;
+    for (const MTLMaterial &material : materials.materials) {
+        MaterialBinding binding;
+        binding.texture = (material.image >= 0)
+            ? textures.getTexture(materials.images[material.image]) : textures.getWhiteTexture();
+        copy(material.diffuse, material.diffuse + 3, binding.diffuse);
+        bindings[material.name] = binding;
+    }
+    render.setMaterials(move(bindings), fallback);
+
+    // textures of earlier versions of the model are not drawn anymore
+    vector<size_t> used = {fallbackHash};
+    for (const TextureImage &image : materials.images) {
+        used.push_back(image.contentHash);
+    }
+    textures.releaseUnused(used);
+    if (!materials.materials.empty()) {
+        cout << "Materials: " << materials.materials.size() << ", textures: " << textures.getTextureCount() << endl;
+    }
+}
+
+// a failed reload (e.g. a file caught mid-export) keeps the current mesh
+static void reloadModel(Render &render, AsyncModelLoader &loader, optional<MaterialSet> &pendingMaterials) {
+    try {
+        MeshUpdate update = render.updateMesh(loader.takeMesh());
+        if (update.partial) {
+            cout << "Model reloaded: " << update.changedBytes / 1024 << " of "
+                << update.totalBytes / 1024 << " KiB changed" << endl;
+        } else {
+            cout << "Model reloaded: new layout, uploading all buffers" << endl;
+        }
+        pendingMaterials = loader.takeMaterials();
+    } catch (const exception &e) {
+        cerr << "Model reload failed, keeping the current mesh: " << e.what() << endl;
+    }
+}
+
+static const char *COMPRESSION_NAMES[] = {"none", "bc1", "bc7"};
+
+// the command line texture; with `timings` the load and the finished upload are timed, to compare the MipmapModes and compressions
+static GLuint loadFallbackTexture(TextureCache &textures, const string &path, const TextureOptions &options,
+    bool timings, size_t &contentHash) {
+    auto start = chrono::steady_clock::now();
+    TextureImage image = TextureImage::load(path, options);
+    contentHash = image.contentHash;
+    auto loaded = chrono::steady_clock::now();
+    GLuint texture = textures.getTexture(image);
+
+    const MipLevel &base = image.mips.getLevel(0);
+    cout << "Texture " << path << ": " << base.width << "x" << base.height << ", "
+        << (options.mipmaps == MIPMAP_CPU || options.compression != COMPRESSION_NONE ? "cpu" : "gpu") << " mipmaps"
+        << ", compression " << COMPRESSION_NAMES[options.compression] << (image.fromCache ? " from cache" : "");
+    if (timings) {
+        glFinish();  // the upload includes glGenerateMipmap()
+        auto uploaded = chrono::steady_clock::now();
+        cout << ", load " << chrono::duration<double, milli>(loaded - start).count() << " ms"
+            << ", upload " << chrono::duration<double, milli>(uploaded - loaded).count() << " ms";
+    }
+    cout << endl;
+    return texture;
+}
+
+// --mipmaps cpu|gpu, --compress none|bc1|bc7 and --timings (texture timings, loader statistics) after the two file arguments
+static bool parseTextureOptions(int args, char *argv[], TextureOptions &options, bool &timings) {
+    for (int i = 3; i < args; i++) {
+        string option = argv[i];
+        if (option == "--timings") {
+            timings = true;
+            continue;
+        }
+        if (i + 1 >= args) {
+            return false;
+        }
+        string value = argv[++i];
+        if (option == "--mipmaps" && (value == "cpu" || value == "gpu")) {
+            options.mipmaps = (value == "gpu") ? MIPMAP_GPU : MIPMAP_CPU;
+            continue;
+        }
+        if (option != "--compress") {
+            return false;
+        }
+        auto name = find(begin(COMPRESSION_NAMES), end(COMPRESSION_NAMES), value);
+        if (name == end(COMPRESSION_NAMES)) {
+            return false;
+        }
+        options.compression = static_cast<TextureCompression>(name - begin(COMPRESSION_NAMES));
+    }
+    return true;
+}
+
 int main(int args, char* argv[]) {
 
     int width = 0, height = 0;
     char *windowName = nullptr;
 
-    if (args < 3) {
-        cout << "Usage: ./scop models/bird.obj textureSources/bird.bmp" << endl;
+    TextureOptions textureOptions;
+    bool timings = false;
+    if (args < 3 || !parseTextureOptions(args, argv, textureOptions, timings)) {
+        cout << "Usage: ./scop models/bird.obj textureSources/bird.bmp [--mipmaps cpu|gpu] [--compress none|bc1|bc7]"
+            " [--timings]" << endl;
         return 0;
     }
     try {
-        RenderModelLoader renderModel(argv[1]);
+        // parses while the window opens; its parse data is gone once the mesh is taken
+        LoaderOptions loaderOptions;
+        loaderOptions.printStats = timings;
+        optional<AsyncModelLoader> loader(in_place, argv[1], loaderOptions, textureOptions);
+        bool modelShown = false;
+
+        // rewrites of the model are loaded again and patched into the GPU buffers
+        FileWatcher watcher(argv[1]);
+        bool reloadPending = false;
 
         Window window(width, height, windowName);
 
@@ -40,8 +158,17 @@ int main(int args, char* argv[]) {
         // cout << "OpenGL version: " << version << endl;
 
         ShaderProgram shaderProgram;
-        Render render(renderModel.getMesh(), shaderProgram);
-        Texture texture(argv[2]);
+        // a placeholder is drawn until the model arrives
+        Render render(AsyncModelLoader::makePlaceholder(), shaderProgram);
+
+        // the texture of everything the model's .mtl files do not cover
+        TextureCache textures;
+        MaterialBinding fallbackMaterial;
+        size_t fallbackHash = 0;
+        fallbackMaterial.texture = loadFallbackTexture(textures, argv[2], textureOptions, timings, fallbackHash);
+        render.setMaterials({}, fallbackMaterial);
+        // the materials of the last load, applied once their textures are uploaded
+        optional<MaterialSet> pendingMaterials;
 
         glUniform1i(render.getUniformLocation().texture, 0);
 
@@ -61,13 +188,40 @@ int main(int args, char* argv[]) {
             double deltaTime = currentTime - prevTime;
             prevTime = currentTime;
 
+            if (watcher.hasChanged()) {
+                reloadPending = true;
+            }
+            if (reloadPending && !loader) {
+                loader.emplace(argv[1], loaderOptions, textureOptions);
+                reloadPending = false;
+            }
+
+            // the model goes up in chunks over a few frames, then replaces the placeholder
+            if (loader && loader->isReady()) {
+                if (modelShown) {
+                    reloadModel(render, *loader, pendingMaterials);
+                } else {
+                    render.updateMesh(loader->takeMesh());
+                    pendingMaterials = loader->takeMaterials();
+                    modelShown = true;
+                }
+                loader.reset();
+            }
+            // one upload per frame: the mesh first, then the material textures
+            if (render.isUploading()) {
+                render.continueUpload();
+            } else if (pendingMaterials && textures.continueUpload(pendingMaterials->images)) {
+                applyMaterials(render, textures, *pendingMaterials, fallbackMaterial, fallbackHash);
+                pendingMaterials.reset();
+            }
+
             render.renderFrame(deltaTime, transformation, camera, material);
             camera.updateView();
             camera.updateProjection();
             transformation.updateModelMatrix();
 
-            // A rendering function
-            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(renderModel.getMesh().indices.size()), GL_UNSIGNED_INT, 0);
+            // A rendering function: visible clusters of the level of detail the screen size allows
+            render.drawMesh(transformation, camera);
 
             // Swap front and back buffers
             window.swapBuffers();
@@ -76,7 +230,7 @@ int main(int args, char* argv[]) {
             glfwPollEvents();
         }
 
-        texture.unbindTexture();
+        textures.cleanUp();
         render.cleanUp();
         return 0;
 
@@ -92,6 +246,8 @@ int main(int args, char* argv[]) {
         cerr << "Matrix transformation error: " << e.what() << endl;
     } catch (const BMPLoaderException &e) {
         cerr << "BMP loader error: " << e.what() << endl;
+    } catch (const QOILoaderException &e) {
+        cerr << "QOI loader error: " << e.what() << endl;
     } catch (const exception &e) {
         cerr << e.what() << endl;
     } catch (...) {
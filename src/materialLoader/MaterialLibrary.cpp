@@ -0,0 +1,200 @@
+#include "MaterialLibrary.hpp"
+#include "../modelLoader/OBJScanner.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include "../texture/TextureImage.hpp"
+#include "../jobs/JobSystem.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include <filesystem>
+#include <iostream>
+#include <exception>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const string_view MTLLIB_KEYWORD = "mtllib";
+
+// `from` resolved against the directory of `file`
+static string resolvePath(const string &file, string_view from) {
+	filesystem::path path(from);
+	if (path.is_relative()) {
+		path = filesystem::path(file).parent_path() / path;
+	}
+	return path.lexically_normal().string();
+}
+
+/**
+* @brief The .mtl files named by the `mtllib` statements of an OBJ file,
+* resolved against its directory, each listed once.
+*
+* The statements are found with memmem() over the mapped file, which
+* keeps up with the disk and does not wait for the OBJ parse. A match
+* counts only at the start of a record.
+*
+* @throws MappedFileException if the file cannot be mapped.
+*/
+vector<string> MaterialLibrary::findLibraries(const string &objPath) {
+	MappedFile file(objPath);
+	const char *data = file.data();
+	const char *end = data + file.size();
+	vector<string> libraries;
+
+	const char *p = data;
+	while (p != end) {
+		const char *match = static_cast<const char *>(memmem(p, end - p, MTLLIB_KEYWORD.data(), MTLLIB_KEYWORD.size()));
+		if (!match) {
+			break;
+		}
+		p = match + MTLLIB_KEYWORD.size();
+
+		const char *lineStart = match;
+		while (lineStart != data && OBJScanner::isBlank(lineStart[-1])) {
+			--lineStart;
+		}
+		if ((lineStart != data && lineStart[-1] != '\n') || (p != end && !OBJScanner::isBlank(*p))) {
+			continue;
+		}
+
+		const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+		eol = eol ? eol : end;
+		// one statement may list several files
+		for (const char *name = OBJScanner::skipBlanks(p, eol); name != eol; name = OBJScanner::skipBlanks(name, eol)) {
+			const char *nameEnd = OBJScanner::findBlank(name, eol);
+			string path = resolvePath(objPath, string_view(name, nameEnd - name));
+			if (find(libraries.begin(), libraries.end(), path) == libraries.end()) {
+				libraries.push_back(move(path));
+			}
+			name = nameEnd;
+		}
+		p = eol;
+	}
+	return libraries;
+}
+
+/**
+* @brief Appends the `newmtl` blocks of the .mtl file at `path`.
+*
+* Kd and map_Kd are read, other statements are skipped. map_Kd options
+* (-s, -o, ...) are ignored: the file name is the last word.
+*
+* @throws MappedFileException if the file cannot be mapped.
+*/
+void MaterialLibrary::parse(const string &path, vector<MTLMaterial> &materials) {
+	MappedFile file(path);
+	const char *p = file.data();
+	const char *end = p + file.size();
+	MTLMaterial *current = nullptr;
+
+	while (p != end) {
+		const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+		eol = eol ? eol : end;
+
+		const char *line = OBJScanner::skipBlanks(p, eol);
+		const char *typeEnd = OBJScanner::findBlank(line, eol);
+		string_view type(line, typeEnd - line);
+		const char *value = OBJScanner::skipBlanks(typeEnd, eol);
+		const char *valueEnd = OBJScanner::trimBlanks(value, eol);
+
+		if (type == "newmtl") {
+			materials.emplace_back();
+			current = &materials.back();
+			current->name.assign(value, valueEnd);
+		} else if (current && type == "Kd") {
+			OBJScanner::scanFloats(value, valueEnd, current->diffuse, 3);
+		} else if (current && type == "map_Kd" && value != valueEnd) {
+			const char *name = valueEnd;
+			while (name != value && !OBJScanner::isBlank(name[-1])) {
+				--name;
+			}
+			current->diffuseMap = resolvePath(path, string_view(name, valueEnd - name));
+		}
+		p = (eol == end) ? end : eol + 1;
+	}
+}
+
+/**
+* @brief Parses every material library of the OBJ file at `objPath` and
+* decodes the textures they use, each file once, on the job system.
+* `textureOptions` select how their levels are prepared, see TextureImage::load().
+*
+* A model without usable materials is not an error: libraries and
+* textures that cannot be read are reported on cerr and skipped, the
+* materials that used such a texture keep only their Kd color.
+*/
+MaterialSet MaterialLibrary::load(const string &objPath, const TextureOptions &textureOptions) {
+	MaterialSet set;
+	vector<string> libraries;
+	try {
+		libraries = findLibraries(objPath);
+	} catch (const MappedFileException &) {
+		return set;  // the model loader reports it
+	}
+
+	for (const string &library : libraries) {
+		try {
+			parse(library, set.materials);
+		} catch (const MappedFileException &e) {
+			cerr << "Material library skipped: " << library << ": " << e.what() << endl;
+		}
+	}
+
+	// the last definition of a name wins
+	unordered_map<string, size_t> byName;
+	vector<MTLMaterial> unique;
+	for (MTLMaterial &material : set.materials) {
+		auto [it, inserted] = byName.try_emplace(material.name, unique.size());
+		if (inserted) {
+			unique.push_back(move(material));
+		} else {
+			unique[it->second] = move(material);
+		}
+	}
+	set.materials = move(unique);
+
+	vector<string> paths;
+	unordered_map<string, int> pathIndex;
+	for (MTLMaterial &material : set.materials) {
+		if (material.diffuseMap.empty()) {
+			continue;
+		}
+		auto [it, inserted] = pathIndex.try_emplace(material.diffuseMap, static_cast<int>(paths.size()));
+		if (inserted) {
+			paths.push_back(material.diffuseMap);
+		}
+		material.image = it->second;
+	}
+
+	vector<optional<TextureImage>> decoded(paths.size());
+	vector<string> errors(paths.size());
+	JobSystem::getShared().parallelFor(paths.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			try {
+				decoded[i].emplace(TextureImage::load(paths[i], textureOptions));
+			} catch (const exception &e) {
+				errors[i] = e.what();
+			}
+		}
+	});
+
+	vector<int> imageOf(paths.size(), -1);
+	for (size_t i = 0; i < decoded.size(); i++) {
+		if (!errors[i].empty()) {
+			cerr << "Texture skipped: " << errors[i] << endl;
+		}
+		if (decoded[i]) {
+			imageOf[i] = static_cast<int>(set.images.size());
+			set.images.push_back(move(*decoded[i]));
+		}
+	}
+	for (MTLMaterial &material : set.materials) {
+		if (material.image >= 0) {
+			material.image = imageOf[material.image];
+		}
+	}
+	return set;
+}
@@ -0,0 +1,44 @@
+/**
+* @file MaterialLibrary.hpp
+* @brief Reads the .mtl files an OBJ file refers to, and their textures.
+*
+* Only what the viewer can show is kept: the diffuse color (Kd) and the
+* diffuse texture (map_Kd) of every `newmtl`. Nothing here needs a GL
+* context; textures are decoded into TextureImage and uploaded later.
+*/
+
+#pragma once
+
+#include "../texture/TextureImage.hpp"
+#include <glad/gl.h>
+#include <string>
+#include <vector>
+
+/**
+* @struct MTLMaterial
+* @brief One `newmtl` block.
+*/
+struct MTLMaterial {
+	std::string name;
+	GLfloat diffuse[3] = {1.0f, 1.0f, 1.0f};  // Kd
+	std::string diffuseMap;                   // map_Kd, resolved against the .mtl directory
+	int image = -1;                           // index into MaterialSet::images, -1 without one
+};
+
+/**
+* @struct MaterialSet
+* @brief The materials of a model with their decoded textures.
+*
+* Every distinct map_Kd file is decoded once, materials share it through
+* their `image` index. Later definitions of a name replace earlier ones.
+*/
+struct MaterialSet {
+	std::vector<MTLMaterial> materials;
+	std::vector<TextureImage> images;
+};
+
+namespace MaterialLibrary {
+	std::vector<std::string> findLibraries(const std::string &objPath);
+	void parse(const std::string &path, std::vector<MTLMaterial> &materials);
+	MaterialSet load(const std::string &objPath, const TextureOptions &textureOptions = TextureOptions());
+}
@@ -0,0 +1,123 @@
+#include "AsyncModelLoader.hpp"
+#include "RenderModelLoader.hpp"
+#include "MeshBuffers.hpp"
+#include "Mesh.hpp"
+#include "../materialLoader/MaterialLibrary.hpp"
+#include <glad/gl.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+static const GLfloat PLACEHOLDER_HALF_SIZE = 10.0f;  // model units, about the size of the sample models
+
+/**
+* @brief Starts loading `path` and its materials on two new threads.
+*/
+AsyncModelLoader::AsyncModelLoader(const string &path, const LoaderOptions &options,
+	const TextureOptions &textureOptions)
+{
+	_thread = thread([this, path, options]() {
+		try {
+			MeshBuffers mesh = RenderModelLoader(path, options).takeMesh();
+			// lets Render::updateMesh() find the changed ranges without touching the rest
+			mesh.hashBlocks();
+			_mesh.emplace(move(mesh));
+		} catch (...) {
+			_error = current_exception();
+		}
+		_ready.store(true, memory_order_release);
+	});
+	_materialThread = thread([this, path, textureOptions]() {
+		// a model never fails over its materials, it is shown without them
+		try {
+			_materials = MaterialLibrary::load(path, textureOptions);
+		} catch (const exception &e) {
+			cerr << "Materials skipped: " << e.what() << endl;
+		}
+		_materialsReady.store(true, memory_order_release);
+	});
+}
+
+AsyncModelLoader::~AsyncModelLoader() {
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+	if (_materialThread.joinable()) {
+		_materialThread.join();
+	}
+}
+
+/**
+* @brief True once takeMesh() and takeMaterials() return without waiting.
+*/
+bool AsyncModelLoader::isReady() const {
+	return _ready.load(memory_order_acquire) && _materialsReady.load(memory_order_acquire);
+}
+
+/**
+* @brief Hands out the loaded mesh, waiting for the load if needed.
+* @throws the exception that ended the load, or
+* RenderModelLoaderException if the mesh was already taken.
+*/
+MeshBuffers AsyncModelLoader::takeMesh() {
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+	if (_error) {
+		rethrow_exception(exchange(_error, nullptr));
+	}
+	if (!_mesh) {
+		throw RenderModelLoaderException(RenderModelLoaderException::UNKNOWN_ERROR);
+	}
+
+	MeshBuffers mesh = move(*_mesh);
+	_mesh.reset();
+	return mesh;
+}
+
+/**
+* @brief Hands out the materials of the model, waiting for them if needed.
+* A second call returns an empty set.
+*/
+MaterialSet AsyncModelLoader::takeMaterials() {
+	if (_materialThread.joinable()) {
+		_materialThread.join();
+	}
+	return exchange(_materials, MaterialSet());
+}
+
+/**
+* @brief Cube shown while the model loads, in the float vertex format.
+*/
+MeshBuffers AsyncModelLoader::makePlaceholder() {
+	const GLfloat s = PLACEHOLDER_HALF_SIZE;
+	vector<GLfloat> vertices;
+	for (int corner = 0; corner < 8; corner++) {
+		GLfloat x = (corner & 1) ? 1.0f : 0.0f;
+		GLfloat y = (corner & 2) ? 1.0f : 0.0f;
+		GLfloat z = (corner & 4) ? 1.0f : 0.0f;
+		// x, y, z, u, v, r, g, b
+		vertices.insert(vertices.end(), {(x * 2 - 1) * s, (y * 2 - 1) * s, (z * 2 - 1) * s, x, y, 0.5f, 0.5f, 0.5f});
+	}
+
+	Mesh mesh;
+	mesh.format = VERTEX_FLOAT;
+	mesh.indices = {
+		0, 2, 1, 1, 2, 3,  // -z
+		4, 5, 6, 5, 7, 6,  // +z
+		0, 1, 4, 1, 5, 4,  // -y
+		2, 6, 3, 3, 6, 7,  // +y
+		0, 4, 2, 2, 4, 6,  // -x
+		1, 3, 5, 3, 7, 5,  // +x
+	};
+
+	BoundingBox bounds;
+	bounds.minX = bounds.minY = bounds.minZ = -s;
+	bounds.maxX = bounds.maxY = bounds.maxZ = s;
+	return MeshBuffers(move(vertices), move(mesh), bounds);
+}
@@ -0,0 +1,58 @@
+/**
+* @file AsyncModelLoader.hpp
+* @brief Runs a RenderModelLoader on a background thread.
+*
+* The viewer opens its window and draws a placeholder while the model
+* parses; the render loop polls isReady() once per frame and never waits
+* for the loader.
+*/
+
+#pragma once
+
+#include "RenderModelLoader.hpp"
+#include "MeshBuffers.hpp"
+#include "../materialLoader/MaterialLibrary.hpp"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <optional>
+#include <exception>
+
+/**
+* @class AsyncModelLoader
+* @brief One model load on its own thread, handed over as MeshBuffers.
+*
+* The data parallel loader stages still run on the job system, the
+* thread only keeps them off the render thread. Exceptions of the load
+* are rethrown by takeMesh(). The destructor waits for an unfinished
+* load, the loader has no cancellation points.
+*
+* The material libraries of the model are read and their textures
+* decoded on a second thread at the same time, see MaterialLibrary::load().
+*/
+class AsyncModelLoader {
+public:
+	explicit AsyncModelLoader(const std::string &path, const LoaderOptions &options = LoaderOptions(),
+		const TextureOptions &textureOptions = TextureOptions());
+	~AsyncModelLoader();
+
+	AsyncModelLoader(const AsyncModelLoader &other) = delete;
+	AsyncModelLoader &operator=(const AsyncModelLoader &other) = delete;
+
+	bool isReady() const;
+	MeshBuffers takeMesh();
+	MaterialSet takeMaterials();
+
+	static MeshBuffers makePlaceholder();
+
+private:
+	std::optional<MeshBuffers> _mesh;
+	std::exception_ptr _error;
+	std::atomic<bool> _ready{false};
+	std::thread _thread;
+	MaterialSet _materials;
+	std::atomic<bool> _materialsReady{false};
+	std::thread _materialThread;
+
+	AsyncModelLoader();
+};
@@ -0,0 +1,142 @@
+/**
+* @file Mesh.hpp
+* @brief Render-ready geometry produced by RenderModelLoader.
+*/
+
+#pragma once
+
+#include "VertexLayout.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+struct BoundingBox {
+	GLfloat minX = 1e10f, maxX = -1e10f;
+	GLfloat minY = 1e10f, maxY = -1e10f;
+	GLfloat minZ = 1e10f, maxZ = -1e10f;
+
+	GLfloat getRangeX() const {
+		GLfloat r = maxX - minX;
+		return (r < 0.0001f) ? 1.0f : r;
+	}
+
+	GLfloat getRangeY() const {
+		GLfloat r = maxY - minY;
+		return (r < 0.0001f) ? 1.0f : r;
+	}
+
+	GLfloat getRangeZ() const {
+		GLfloat r = maxZ - minZ;
+		return (r < 0.0001f) ? 1.0f : r;
+	}
+};
+
+/**
+* @struct PositionDecode
+* @brief Maps stored positions back to model space: offset + stored * scale.
+*
+* Float positions are stored as is, normalized ones as [0, 1] within the
+* bounding box, which the vertex shader undoes with these two uniforms.
+*/
+struct PositionDecode {
+    GLfloat offset[3] = {0.0f, 0.0f, 0.0f};
+    GLfloat scale[3] = {1.0f, 1.0f, 1.0f};
+
+    static PositionDecode fromBounds(const BoundingBox &bounds, VertexFormat format) {
+        PositionDecode decode;
+        bool boundsRelative = visitVertexLayout(format, [](auto layout) {
+            return decltype(layout)::BOUNDS_RELATIVE_POSITION;
+        });
+        if (boundsRelative) {
+            decode.offset[0] = bounds.minX;
+            decode.offset[1] = bounds.minY;
+            decode.offset[2] = bounds.minZ;
+            decode.scale[0] = bounds.getRangeX();
+            decode.scale[1] = bounds.getRangeY();
+            decode.scale[2] = bounds.getRangeZ();
+        }
+        return decode;
+    }
+};
+
+/**
+* @struct MeshLod
+* @brief One level of detail: a range of the shared index buffer.
+*
+* `error` is the geometric deviation from the full mesh in model units;
+* level 0 is the full mesh with error 0.
+*/
+struct MeshLod {
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+    GLfloat error = 0.0f;
+};
+
+/**
+* @struct MeshCluster
+* @brief A run of at most MeshClusterizer::MAX_TRIANGLES triangles with culling bounds.
+*
+* The cluster is back-facing from every camera position p with
+* dot(center - p, coneAxis) >= coneCutoff * |center - p| + radius;
+* coneCutoff 1 never culls. All values are in model space.
+*/
+struct MeshCluster {
+    GLuint firstIndex = 0;
+    GLuint indexCount = 0;
+    GLfloat center[3] = {0.0f, 0.0f, 0.0f};
+    GLfloat radius = 0.0f;
+    GLfloat coneAxis[3] = {0.0f, 0.0f, 0.0f};
+    GLfloat coneCutoff = 1.0f;
+};
+
+/**
+* @struct MeshSubmesh
+* @brief Consecutive faces that share an OBJ object/group name and material.
+*
+* Its index range in every level of detail is in Mesh::submeshLods. The
+* bounding sphere holds the faces of level 0, and with them those of the
+* coarser levels, which use a subset of its vertices. Names are offsets
+* into Mesh::names.
+*/
+struct MeshSubmesh {
+    GLuint nameOffset = 0;
+    GLuint materialOffset = 0;
+    GLfloat center[3] = {0.0f, 0.0f, 0.0f};
+    GLfloat radius = 0.0f;
+};
+
+struct Mesh {
+    static constexpr GLuint FLOATS_PER_VERTEX = SOURCE_FLOATS_PER_VERTEX;  // float build buffer, see VERTEX_SEMANTICS
+
+    VertexFormat format = VERTEX_FLOAT;
+    std::vector<GLubyte> vertices;   // interleaved, getVertexStride(format) bytes per vertex
+    std::vector<GLuint> indices;     // three per triangle, into vertices; LODs back to back
+    std::vector<MeshLod> lods;       // finest first, empty means one level over all indices
+    std::vector<MeshCluster> clusters;  // in index order, none crosses a LOD or submesh boundary
+    std::vector<MeshSubmesh> submeshes;  // in index order, empty means one over all indices
+    std::vector<MeshLod> submeshLods;    // range of submesh s in level l at [l * submeshes.size() + s]
+    std::vector<char> names;             // NUL terminated submesh names, offset 0 is ""
+};
+
+/**
+* @struct MeshView
+* @brief Non-owning view of mesh buffers ready for upload.
+*
+* Points either into a Mesh or into a memory-mapped mesh cache, so the
+* renderer does not care where the data comes from.
+*/
+struct MeshView {
+    VertexFormat format = VERTEX_FLOAT;
+    PositionDecode decode;
+    std::span<const GLubyte> vertices;
+    std::span<const GLuint> indices;
+    std::span<const MeshLod> lods;
+    std::span<const MeshCluster> clusters;
+    std::span<const MeshSubmesh> submeshes;
+    std::span<const MeshLod> submeshLods;
+    std::span<const char> names;
+
+    size_t getVertexCount() const { return vertices.size() / getVertexStride(format); }
+};
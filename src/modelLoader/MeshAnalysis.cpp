@@ -0,0 +1,28 @@
+#include "MeshAnalysis.hpp"
+#include <glad/gl.h>
+#include <vector>
+
+using namespace std;
+
+VertexCacheStats MeshAnalysis::analyzeVertexCache(const vector<GLuint> &indices, size_t vertexCount, size_t cacheSize) {
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0 || cacheSize == 0) {
+		return stats;
+	}
+
+	// A vertex is cached while fewer than cacheSize misses happened after it was loaded
+	vector<size_t> loadedAt(vertexCount, 0);
+	size_t misses = 0;
+
+	for (GLuint index : indices) {
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize) {
+			misses++;
+			loadedAt[index] = misses;
+		}
+	}
+
+	stats.acmr = static_cast<double>(misses) / (indices.size() / 3);
+	stats.atvr = static_cast<double>(misses) / vertexCount;
+	stats.hitRate = 1.0 - static_cast<double>(misses) / indices.size();
+	return stats;
+}
@@ -0,0 +1,34 @@
+/**
+* @file MeshAnalysis.hpp
+* @brief Statistics about an indexed triangle list, printed by the loader.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+
+/**
+* @struct VertexCacheStats
+* @brief Result of replaying an index buffer through a FIFO vertex cache.
+*
+* acmr: vertex shader invocations per triangle (0.5 ideal, 3.0 worst)
+* atvr: vertex shader invocations per unique vertex (1.0 ideal)
+* hitRate: share of index fetches served by the cache
+*/
+struct VertexCacheStats {
+	double acmr = 0.0;
+	double atvr = 0.0;
+	double hitRate = 0.0;
+};
+
+namespace MeshAnalysis {
+	/**
+	* @brief Simulates a post-transform FIFO cache of `cacheSize` entries.
+	*
+	* A FIFO of 16-32 entries is a common model for the cache GPUs and
+	* software rasterizers keep between vertex shading and assembly.
+	*/
+	VertexCacheStats analyzeVertexCache(const std::vector<GLuint> &indices, size_t vertexCount, size_t cacheSize = 32);
+}
@@ -0,0 +1,171 @@
+#include "MeshBuffers.hpp"
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "VertexPacker.hpp"
+#include "../jobs/JobSystem.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <span>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/**
+* @brief Same layout: same format and counts, hashed with the same blocks.
+* Meshes without hashes never compare.
+*/
+bool BlockHashes::isComparable(const BlockHashes &other) const {
+	return blockVertices != 0 && blockIndices != 0
+		&& format == other.format && vertexCount == other.vertexCount && indexCount == other.indexCount
+		&& blockVertices == other.blockVertices && blockIndices == other.blockIndices;
+}
+
+// 64-bit multiply-xorshift over 8 byte words, the tail is zero padded
+static uint64_t hashBytes(const GLubyte *data, size_t size) {
+	uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 31;
+	}
+	if (i < size) {
+		uint64_t word = 0;
+		memcpy(&word, data + i, size - i);
+		h = (h ^ word) * 0x94D049BB133111EBull;
+	}
+	return h ^ (h >> 32);
+}
+
+MeshBuffers::MeshBuffers(Mesh &&mesh, const BoundingBox &bounds)
+	: _mesh(move(mesh)), _bounds(bounds) {}
+
+MeshBuffers::MeshBuffers(vector<GLfloat> &&sourceVertices, Mesh &&mesh, const BoundingBox &bounds)
+	: _mesh(move(mesh)), _sourceVertices(move(sourceVertices)), _bounds(bounds) {}
+
+MeshBuffers::MeshBuffers(MeshCache &&cache)
+	: _cache(move(cache))
+{
+	_bounds = _cache->getBounds();
+}
+
+/**
+* @brief Writes vertices [first, first + count) in the packed format.
+*
+* `dest` receives count * getVertexStride(getFormat()) bytes. Deferred
+* buffers are packed here, packed ones are copied.
+*/
+void MeshBuffers::packVertices(size_t first, size_t count, GLubyte *dest) const {
+	if (!isPacked()) {
+		VertexPacker::pack(&_sourceVertices[first * Mesh::FLOATS_PER_VERTEX], count, _mesh.format,
+			PositionDecode::fromBounds(_bounds, _mesh.format), dest);
+		return;
+	}
+
+	const size_t stride = getVertexStride(getFormat());
+	MeshView view = getView();
+	memcpy(dest, view.vertices.data() + first * stride, count * stride);
+}
+
+/**
+* @brief Hashes the packed vertices and the indices in blocks of about
+* HASH_BLOCK_BYTES, see getBlockHashes().
+*
+* Deferred vertices are packed block by block for this. Meant for the
+* loading thread, so the render thread only compares the results.
+*/
+void MeshBuffers::hashBlocks() {
+	const size_t stride = getVertexStride(getFormat());
+	span<const GLuint> indices = getIndices();
+
+	_hashes = BlockHashes();
+	_hashes.format = getFormat();
+	_hashes.vertexCount = getVertexCount();
+	_hashes.indexCount = indices.size();
+	_hashes.blockVertices = max<size_t>(1, HASH_BLOCK_BYTES / stride);
+	_hashes.blockIndices = HASH_BLOCK_BYTES / sizeof(GLuint);
+	_hashes.vertices.resize((_hashes.vertexCount + _hashes.blockVertices - 1) / _hashes.blockVertices);
+	_hashes.indices.resize((_hashes.indexCount + _hashes.blockIndices - 1) / _hashes.blockIndices);
+
+	JobSystem::getShared().parallelFor(_hashes.vertices.size(), 1, [&](size_t first, size_t last) {
+		vector<GLubyte> packed(_hashes.blockVertices * stride);
+		for (size_t block = first; block < last; block++) {
+			size_t begin = block * _hashes.blockVertices;
+			size_t count = min(_hashes.blockVertices, _hashes.vertexCount - begin);
+			packVertices(begin, count, packed.data());
+			_hashes.vertices[block] = hashBytes(packed.data(), count * stride);
+		}
+	});
+
+	const GLubyte *indexBytes = reinterpret_cast<const GLubyte *>(indices.data());
+	for (size_t block = 0; block < _hashes.indices.size(); block++) {
+		size_t begin = block * _hashes.blockIndices;
+		size_t count = min(_hashes.blockIndices, _hashes.indexCount - begin);
+		_hashes.indices[block] = hashBytes(indexBytes + begin * sizeof(GLuint), count * sizeof(GLuint));
+	}
+}
+
+// getters //
+
+bool MeshBuffers::isPacked() const {
+	return _cache || _sourceVertices.empty();
+}
+
+/**
+* @brief View of the packed buffers; vertices are empty while deferred.
+*/
+MeshView MeshBuffers::getView() const {
+	if (_cache) {
+		return _cache->getView();
+	}
+
+	MeshView view;
+	view.format = _mesh.format;
+	view.decode = PositionDecode::fromBounds(_bounds, _mesh.format);
+	view.vertices = _mesh.vertices;
+	view.indices = _mesh.indices;
+	view.lods = _mesh.lods;
+	view.clusters = _mesh.clusters;
+	view.submeshes = _mesh.submeshes;
+	view.submeshLods = _mesh.submeshLods;
+	view.names = _mesh.names;
+	return view;
+}
+
+VertexFormat MeshBuffers::getFormat() const {
+	return _cache ? _cache->getView().format : _mesh.format;
+}
+
+size_t MeshBuffers::getVertexCount() const {
+	if (!isPacked()) {
+		return _sourceVertices.size() / Mesh::FLOATS_PER_VERTEX;
+	}
+	return getView().getVertexCount();
+}
+
+span<const GLuint> MeshBuffers::getIndices() const {
+	return getView().indices;
+}
+
+span<const MeshLod> MeshBuffers::getLods() const {
+	return getView().lods;
+}
+
+span<const MeshCluster> MeshBuffers::getClusters() const {
+	return getView().clusters;
+}
+
+const BoundingBox &MeshBuffers::getBounds() const {
+	return _bounds;
+}
+
+/**
+* @brief Block hashes from hashBlocks(), without blocks if never hashed.
+*/
+const BlockHashes &MeshBuffers::getBlockHashes() const {
+	return _hashes;
+}
@@ -0,0 +1,85 @@
+/**
+* @file MeshBuffers.hpp
+* @brief Move-only hand-off of finished mesh buffers from loader to renderer.
+*/
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <optional>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* @struct BlockHashes
+* @brief Hashes of fixed size blocks of the packed buffers.
+*
+* Two versions of a model with the same layout can be compared block by
+* block to find the ranges of the GPU buffers that need an update.
+*/
+struct BlockHashes {
+	VertexFormat format = VERTEX_FLOAT;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	size_t blockVertices = 0;  // vertices per block, the last one may be shorter
+	size_t blockIndices = 0;
+	std::vector<uint64_t> vertices;
+	std::vector<uint64_t> indices;
+
+	bool isComparable(const BlockHashes &other) const;
+};
+
+/**
+* @class MeshBuffers
+* @brief Owns the final vertex and index buffers of one model.
+*
+* The vertices are held in one of three forms:
+* - packed: a built Mesh, ready for glBufferData()
+* - mapped: a MeshCache hit, packed as well
+* - deferred: the loader's float build buffer next to a Mesh without
+*   vertices, packed on demand by packVertices(), so consumers can stream packed chunks straight into
+*   their destination without a packed copy of the whole mesh
+*
+* Ownership only moves: RenderModelLoader::takeMesh() hands the buffers
+* out, Render takes them by value, uploads them and lets them go, which
+* frees the CPU copies (or unmaps the cache) once the GPU has the data.
+*/
+class MeshBuffers {
+public:
+	MeshBuffers(Mesh &&mesh, const BoundingBox &bounds);
+	MeshBuffers(std::vector<GLfloat> &&sourceVertices, Mesh &&mesh, const BoundingBox &bounds);
+	explicit MeshBuffers(MeshCache &&cache);
+
+	MeshBuffers(MeshBuffers &&other) = default;
+	MeshBuffers &operator=(MeshBuffers &&other) = default;
+	MeshBuffers(const MeshBuffers &other) = delete;
+	MeshBuffers &operator=(const MeshBuffers &other) = delete;
+
+	static constexpr size_t HASH_BLOCK_BYTES = 64 << 10;
+
+	void packVertices(size_t first, size_t count, GLubyte *dest) const;
+	void hashBlocks();
+
+	bool isPacked() const;
+	MeshView getView() const;
+	VertexFormat getFormat() const;
+	size_t getVertexCount() const;
+	std::span<const GLuint> getIndices() const;
+	std::span<const MeshLod> getLods() const;
+	std::span<const MeshCluster> getClusters() const;
+	const BoundingBox &getBounds() const;
+	const BlockHashes &getBlockHashes() const;
+
+private:
+	Mesh _mesh;
+	std::vector<GLfloat> _sourceVertices;
+	std::optional<MeshCache> _cache;
+	BoundingBox _bounds;
+	BlockHashes _hashes;
+
+	MeshBuffers();
+};
@@ -0,0 +1,288 @@
+#include "MeshCache.hpp"
+#include "Mesh.hpp"
+#include "MeshBuffers.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include "../jobs/JobSystem.hpp"
+#include <glad/gl.h>
+#include <string>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cstddef> // offsetof
+#include <cstdio> // remove()
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <unistd.h> // getpid()
+
+using namespace std;
+
+static const char MAGIC[8] = {'S', 'C', 'O', 'P', 'M', 'E', 'S', 'H'};
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const size_t INDEX_SCAN_GRAIN = 1 << 18;  // indices per parallelFor() range
+
+static_assert(sizeof(MeshCacheHeader) <= MeshCache::DATA_OFFSET, "cache header overlaps data");
+
+/**
+* @brief Prepares the cache lookup key from the current state of the source.
+*
+* If the source cannot be inspected the cache is never used.
+*/
+MeshCache::MeshCache(const string &sourcePath, VertexFormat format, uint32_t flags, uint32_t lodLevels)
+	: _path(sourcePath + ".scopmesh")
+{
+	memset(&_key, 0, sizeof(_key));
+	memcpy(_key.magic, MAGIC, sizeof(MAGIC));
+	_key.version = VERSION;
+	_key.byteOrder = BYTE_ORDER_MARK;
+	_key.vertexFormat = format;
+	_key.flags = flags;
+	_key.lodLevels = lodLevels;
+
+	error_code ec;
+	uintmax_t size = filesystem::file_size(sourcePath, ec);
+	if (ec) {
+		return;
+	}
+	filesystem::file_time_type time = filesystem::last_write_time(sourcePath, ec);
+	if (ec) {
+		return;
+	}
+
+	_key.sourceSize = size;
+	_key.sourceTime = static_cast<int64_t>(time.time_since_epoch().count());
+	_sourceFound = true;
+}
+
+// takes `count` elements of `size` bytes off `remaining`, false if they do not fit
+static bool takeBytes(uint64_t &remaining, uint64_t count, uint64_t size) {
+	if (size != 0 && count > remaining / size) {
+		return false;
+	}
+	remaining -= count * size;
+	return true;
+}
+
+// whether every index is below `vertexCount`, scanned in parallel over the mapping
+static bool areIndicesInRange(const GLuint *indices, uint64_t indexCount, uint64_t vertexCount) {
+	atomic<bool> inRange(true);
+	JobSystem::getShared().parallelFor(indexCount, INDEX_SCAN_GRAIN, [&](size_t first, size_t last) {
+		GLuint largest = 0;
+		for (size_t i = first; i < last; i++) {
+			largest = max(largest, indices[i]);
+		}
+		if (largest >= vertexCount) {
+			inRange.store(false, memory_order_relaxed);
+		}
+	});
+	return inRange.load();
+}
+
+/**
+* @brief Maps the cache file if it exists and matches the source.
+* @return true on a cache hit; the buffers are then valid until destruction.
+*/
+bool MeshCache::load() {
+	if (!_sourceFound) {
+		return false;
+	}
+
+	try {
+		MappedFile file(_path);
+		if (file.size() < DATA_OFFSET) {
+			return false;
+		}
+
+		MeshCacheHeader header;
+		memcpy(&header, file.data(), sizeof(header));
+
+		// everything up to the counts must match the expected key
+		const size_t keySize = offsetof(MeshCacheHeader, vertexBytes);
+		if (memcmp(&header, &_key, keySize) != 0) {
+			return false;
+		}
+
+		// the counts must describe exactly the rest of the file; each one is
+		// checked against what is left before it is multiplied, so none can wrap
+		uint64_t remaining = file.size() - DATA_OFFSET;
+		if (!takeBytes(remaining, header.vertexBytes, 1)
+			|| !takeBytes(remaining, header.indexCount, sizeof(GLuint))
+			|| !takeBytes(remaining, header.lodCount, sizeof(MeshLod))
+			|| !takeBytes(remaining, header.clusterCount, sizeof(MeshCluster))
+			|| !takeBytes(remaining, header.submeshCount, sizeof(MeshSubmesh))
+			|| !takeBytes(remaining, header.submeshCount, header.lodCount * sizeof(MeshLod))
+			|| !takeBytes(remaining, header.nameBytes, 1)
+			|| remaining != 0) {
+			return false;
+		}
+		VertexFormat format = static_cast<VertexFormat>(header.vertexFormat);
+		const size_t stride = getVertexStride(format);
+		if (header.vertexBytes % stride != 0) {
+			return false;
+		}
+
+		// a stale or corrupt cache must not hand out-of-range indices to the GPU
+		const GLuint *indices = reinterpret_cast<const GLuint *>(file.data() + DATA_OFFSET + header.vertexBytes);
+		if (!areIndicesInRange(indices, header.indexCount, header.vertexBytes / stride)) {
+			return false;
+		}
+
+		// every level and cluster must stay inside the index buffer
+		const char *tables = file.data() + DATA_OFFSET + header.vertexBytes + header.indexCount * sizeof(GLuint);
+		const MeshLod *lods = reinterpret_cast<const MeshLod *>(tables);
+		for (uint64_t i = 0; i < header.lodCount; i++) {
+			if (static_cast<uint64_t>(lods[i].firstIndex) + lods[i].indexCount > header.indexCount) {
+				return false;
+			}
+		}
+		const MeshCluster *clusters = reinterpret_cast<const MeshCluster *>(lods + header.lodCount);
+		for (uint64_t i = 0; i < header.clusterCount; i++) {
+			if (static_cast<uint64_t>(clusters[i].firstIndex) + clusters[i].indexCount > header.indexCount) {
+				return false;
+			}
+		}
+
+		// and every submesh range, and names must be terminated
+		const MeshSubmesh *submeshes = reinterpret_cast<const MeshSubmesh *>(clusters + header.clusterCount);
+		const MeshLod *submeshLods = reinterpret_cast<const MeshLod *>(submeshes + header.submeshCount);
+		for (uint64_t i = 0; i < header.submeshCount * header.lodCount; i++) {
+			if (static_cast<uint64_t>(submeshLods[i].firstIndex) + submeshLods[i].indexCount > header.indexCount) {
+				return false;
+			}
+		}
+		const char *names = reinterpret_cast<const char *>(submeshLods + header.submeshCount * header.lodCount);
+		for (uint64_t i = 0; i < header.submeshCount; i++) {
+			if (submeshes[i].nameOffset >= header.nameBytes || submeshes[i].materialOffset >= header.nameBytes) {
+				return false;
+			}
+		}
+		if (header.nameBytes > 0 && names[header.nameBytes - 1] != '\0') {
+			return false;
+		}
+
+		_key = header;
+		_file.emplace(move(file));
+		return true;
+	} catch (const MappedFileException &) {
+		return false;
+	}
+}
+
+/**
+* @brief Writes the cache for the current source state.
+*
+* The file is written under a temporary name and renamed into place, so
+* a concurrent reader never sees a partial cache. Vertices are packed
+* through a WRITE_CHUNK_BYTES staging buffer, which works for deferred
+* buffers without packing the whole mesh at once.
+*
+* @return false if the cache could not be written (e.g. read-only directory).
+*/
+bool MeshCache::store(const MeshBuffers &buffers) const {
+	if (!_sourceFound) {
+		return false;
+	}
+
+	const BoundingBox &bounds = buffers.getBounds();
+	const size_t stride = getVertexStride(buffers.getFormat());
+	const size_t vertexCount = buffers.getVertexCount();
+	span<const GLuint> indices = buffers.getIndices();
+	span<const MeshLod> lods = buffers.getLods();
+	span<const MeshCluster> clusters = buffers.getClusters();
+	MeshView view = buffers.getView();
+
+	MeshCacheHeader header = _key;
+	header.vertexFormat = buffers.getFormat();
+	header.vertexBytes = vertexCount * stride;
+	header.indexCount = indices.size();
+	header.lodCount = lods.size();
+	header.clusterCount = clusters.size();
+	header.submeshCount = view.submeshes.size();
+	header.nameBytes = view.names.size();
+	const GLfloat box[6] = {bounds.minX, bounds.maxX, bounds.minY, bounds.maxY, bounds.minZ, bounds.maxZ};
+	memcpy(header.bounds, box, sizeof(box));
+
+	string tmpPath = _path + ".tmp" + to_string(getpid());
+	{
+		ofstream out(tmpPath, ios::binary | ios::trunc);
+		if (!out) {
+			return false;
+		}
+
+		char padding[DATA_OFFSET] = {};
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(padding, DATA_OFFSET - sizeof(header));
+
+		const size_t chunkVertices = max<size_t>(1, WRITE_CHUNK_BYTES / stride);
+		vector<GLubyte> staging(min(chunkVertices, vertexCount) * stride);
+		for (size_t first = 0; first < vertexCount; first += chunkVertices) {
+			size_t count = min(chunkVertices, vertexCount - first);
+			buffers.packVertices(first, count, staging.data());
+			out.write(reinterpret_cast<const char *>(staging.data()), count * stride);
+		}
+		out.write(reinterpret_cast<const char *>(indices.data()), indices.size_bytes());
+		out.write(reinterpret_cast<const char *>(lods.data()), lods.size_bytes());
+		out.write(reinterpret_cast<const char *>(clusters.data()), clusters.size_bytes());
+		out.write(reinterpret_cast<const char *>(view.submeshes.data()), view.submeshes.size_bytes());
+		out.write(reinterpret_cast<const char *>(view.submeshLods.data()), view.submeshLods.size_bytes());
+		out.write(view.names.data(), view.names.size_bytes());
+		if (!out) {
+			out.close();
+			remove(tmpPath.c_str());
+			return false;
+		}
+	}
+
+	error_code ec;
+	filesystem::rename(tmpPath, _path, ec);
+	if (ec) {
+		remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+// getters //
+
+MeshView MeshCache::getView() const {
+	MeshView view;
+	if (!_file) {
+		return view;
+	}
+
+	const char *data = _file->data() + DATA_OFFSET;
+	const GLubyte *vertices = reinterpret_cast<const GLubyte *>(data);
+	const GLuint *indices = reinterpret_cast<const GLuint *>(data + _key.vertexBytes);
+	const MeshLod *lods = reinterpret_cast<const MeshLod *>(indices + _key.indexCount);
+	view.format = static_cast<VertexFormat>(_key.vertexFormat);
+	view.decode = PositionDecode::fromBounds(getBounds(), view.format);
+	view.vertices = span<const GLubyte>(vertices, _key.vertexBytes);
+	view.indices = span<const GLuint>(indices, _key.indexCount);
+	view.lods = span<const MeshLod>(lods, _key.lodCount);
+	const MeshCluster *clusters = reinterpret_cast<const MeshCluster *>(lods + _key.lodCount);
+	const MeshSubmesh *submeshes = reinterpret_cast<const MeshSubmesh *>(clusters + _key.clusterCount);
+	const MeshLod *submeshLods = reinterpret_cast<const MeshLod *>(submeshes + _key.submeshCount);
+	view.clusters = span<const MeshCluster>(clusters, _key.clusterCount);
+	view.submeshes = span<const MeshSubmesh>(submeshes, _key.submeshCount);
+	view.submeshLods = span<const MeshLod>(submeshLods, _key.submeshCount * _key.lodCount);
+	view.names = span<const char>(reinterpret_cast<const char *>(submeshLods + _key.submeshCount * _key.lodCount),
+		_key.nameBytes);
+	return view;
+}
+
+BoundingBox MeshCache::getBounds() const {
+	BoundingBox bounds;
+	bounds.minX = _key.bounds[0];
+	bounds.maxX = _key.bounds[1];
+	bounds.minY = _key.bounds[2];
+	bounds.maxY = _key.bounds[3];
+	bounds.minZ = _key.bounds[4];
+	bounds.maxZ = _key.bounds[5];
+	return bounds;
+}
+
+const string &MeshCache::getPath() const {
+	return _path;
+}
@@ -0,0 +1,84 @@
+/**
+* @file MeshCache.hpp
+* @brief Versioned binary cache (.scopmesh) of a finished Mesh.
+*
+* The cache sits next to the source model (`model.obj.scopmesh`) and
+* holds the final interleaved vertex buffer, the index buffer, the
+* level-of-detail, cluster and submesh tables. It is
+* keyed by the size and modification time of the source file, so any
+* edit of the model invalidates it, and by the VertexFormat, Flags and
+* LOD level count of the loader options that shaped the buffers. Loading maps the file and exposes
+* the buffers in place, ready for glBufferData().
+*
+* File layout: MeshCacheHeader, padding up to DATA_OFFSET, vertex
+* bytes, indices, MeshLod table, MeshCluster table, MeshSubmesh table,
+* submesh MeshLod table, submesh names. Quantized positions are decoded with
+* the stored bounds.
+*/
+
+#pragma once
+
+#include "Mesh.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include <glad/gl.h>
+#include <string>
+#include <optional>
+#include <cstdint>
+
+class MeshBuffers;
+
+#pragma pack(push, 1)
+struct MeshCacheHeader {
+	char magic[8];             // "SCOPMESH"
+	uint32_t version;
+	uint32_t byteOrder;        // 0x01020304 as written by the producing machine
+	uint64_t sourceSize;
+	int64_t sourceTime;        // modification time of the source, file clock ticks
+	uint32_t vertexFormat;     // VertexFormat of the vertex bytes
+	uint32_t flags;            // MeshCache::Flags the mesh was built with
+	uint32_t lodLevels;        // LOD levels requested by the loader options
+	uint32_t reserved;
+	uint64_t vertexBytes;
+	uint64_t indexCount;
+	uint64_t lodCount;         // MeshLod entries after the indices
+	uint64_t clusterCount;     // MeshCluster entries after the LODs
+	uint64_t submeshCount;     // MeshSubmesh entries after the clusters, lodCount ranges each
+	uint64_t nameBytes;        // submesh names after the submesh ranges
+	GLfloat bounds[6];         // minX, maxX, minY, maxY, minZ, maxZ
+};
+#pragma pack(pop)
+
+/**
+* @class MeshCache
+* @brief Looks up, maps and writes the cache file of one source model.
+*/
+class MeshCache {
+public:
+	static constexpr uint32_t VERSION = 5;
+	static constexpr size_t DATA_OFFSET = 128;
+	static constexpr size_t WRITE_CHUNK_BYTES = 1 << 20;
+
+	// loader options that change the cached buffers, part of the key
+	enum Flags {
+		VERTEX_CACHE_OPTIMIZED = 1 << 0,
+		NORMALS_AREA_WEIGHTED = 1 << 1,
+		NORMALS_ANGLE_WEIGHTED = 1 << 2,
+	};
+
+	MeshCache(const std::string &sourcePath, VertexFormat format, uint32_t flags, uint32_t lodLevels);
+
+	bool load();
+	bool store(const MeshBuffers &buffers) const;
+
+	MeshView getView() const;
+	BoundingBox getBounds() const;
+	const std::string &getPath() const;
+
+private:
+	std::string _path;
+	MeshCacheHeader _key;
+	bool _sourceFound = false;
+	std::optional<MappedFile> _file;
+
+	MeshCache();
+};
@@ -0,0 +1,194 @@
+#include "MeshClusterizer.hpp"
+#include "VertexWelder.hpp"
+#include "Mesh.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+static void getTriangleNormal(const GLfloat *p0, const GLfloat *p1, const GLfloat *p2, GLfloat *normal) {
+	const GLfloat e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+	const GLfloat e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+	GLfloat length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	GLfloat inv = (length > 0.0f) ? 1.0f / length : 0.0f;
+	normal[0] *= inv;
+	normal[1] *= inv;
+	normal[2] *= inv;
+}
+
+bool MeshClusterizer::isClosed(const vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+	const vector<GLuint> &indices, size_t firstIndex, size_t indexCount)
+{
+	// vertices that share a position (attribute seams) are one corner here
+	const size_t vertexCount = vertices.size() / floatsPerVertex;
+	vector<GLuint> positionOf(vertexCount);
+	VertexWelder welder(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		const GLfloat *p = &vertices[v * floatsPerVertex + positionOffset];
+		VertexKey key;
+		memcpy(&key.v, &p[0], sizeof(GLuint));
+		memcpy(&key.vt, &p[1], sizeof(GLuint));
+		memcpy(&key.vn, &p[2], sizeof(GLuint));
+
+		bool inserted;
+		positionOf[v] = welder.weld(key, inserted);
+	}
+
+	vector<uint64_t> edges;
+	edges.reserve(indexCount);
+	for (size_t t = firstIndex; t + 2 < firstIndex + indexCount; t += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = positionOf[indices[t + k]];
+			uint64_t b = positionOf[indices[t + (k + 1) % 3]];
+			edges.push_back(a << 32 | b);
+		}
+	}
+	sort(edges.begin(), edges.end());
+
+	// every directed edge occurs once and so does its opposite
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (i + 1 < edges.size() && edges[i + 1] == edges[i]) {
+			return false;
+		}
+		uint64_t opposite = (edges[i] << 32) | (edges[i] >> 32);
+		if (!binary_search(edges.begin(), edges.end(), opposite)) {
+			return false;
+		}
+	}
+	return !edges.empty();
+}
+
+/**
+* @brief Fills the sphere and cone of a finished cluster.
+*
+* The sphere is centered on the bounding box of the cluster vertices.
+* The cone axis is the mean triangle normal; its cutoff is the sine of
+* the widest normal angle, so the test in MeshCluster adds 90 degrees
+* on both sides and asks whether the camera is inside the inverted cone.
+*/
+static void computeBounds(const vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+	const vector<GLuint> &indices, bool coneCulling, MeshCluster &cluster)
+{
+	GLfloat minP[3] = {HUGE_VALF, HUGE_VALF, HUGE_VALF};
+	GLfloat maxP[3] = {-HUGE_VALF, -HUGE_VALF, -HUGE_VALF};
+	GLfloat axis[3] = {0.0f, 0.0f, 0.0f};
+	const size_t end = cluster.firstIndex + cluster.indexCount;
+
+	for (size_t t = cluster.firstIndex; t < end; t += 3) {
+		const GLfloat *p[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = &vertices[indices[t + k] * floatsPerVertex + positionOffset];
+			for (int c = 0; c < 3; c++) {
+				minP[c] = min(minP[c], p[k][c]);
+				maxP[c] = max(maxP[c], p[k][c]);
+			}
+		}
+		GLfloat normal[3];
+		getTriangleNormal(p[0], p[1], p[2], normal);
+		for (int c = 0; c < 3; c++) {
+			axis[c] += normal[c];
+		}
+	}
+
+	GLfloat radiusSquared = 0.0f;
+	for (int c = 0; c < 3; c++) {
+		cluster.center[c] = (minP[c] + maxP[c]) * 0.5f;
+	}
+	for (size_t i = cluster.firstIndex; i < end; i++) {
+		const GLfloat *p = &vertices[indices[i] * floatsPerVertex + positionOffset];
+		GLfloat d[3] = {p[0] - cluster.center[0], p[1] - cluster.center[1], p[2] - cluster.center[2]};
+		radiusSquared = max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	}
+	cluster.radius = sqrt(radiusSquared);
+
+	cluster.coneCutoff = 1.0f;
+	GLfloat length = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (!coneCulling || length <= 0.0f) {
+		return;
+	}
+	for (int c = 0; c < 3; c++) {
+		cluster.coneAxis[c] = axis[c] / length;
+	}
+
+	GLfloat minDot = 1.0f;
+	for (size_t t = cluster.firstIndex; t < end; t += 3) {
+		GLfloat normal[3];
+		getTriangleNormal(&vertices[indices[t] * floatsPerVertex + positionOffset],
+			&vertices[indices[t + 1] * floatsPerVertex + positionOffset],
+			&vertices[indices[t + 2] * floatsPerVertex + positionOffset], normal);
+		minDot = min(minDot, normal[0] * cluster.coneAxis[0] + normal[1] * cluster.coneAxis[1]
+			+ normal[2] * cluster.coneAxis[2]);
+	}
+	if (minDot > MeshClusterizer::CONE_MIN_DOT) {
+		cluster.coneCutoff = sqrt(1.0f - minDot * minDot);
+	}
+}
+
+void MeshClusterizer::buildClusters(const vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+	const vector<GLuint> &indices, size_t firstIndex, size_t indexCount, bool coneCulling,
+	vector<GLuint> &vertexStamps, GLuint &lastStamp, vector<MeshCluster> &clusters)
+{
+	const size_t end = firstIndex + indexCount;
+
+	MeshCluster cluster;
+	size_t clusterVertices = 0;
+	GLfloat normalSum[3] = {0.0f, 0.0f, 0.0f};
+
+	auto finish = [&]() {
+		if (cluster.indexCount > 0) {
+			computeBounds(vertices, floatsPerVertex, positionOffset, indices, coneCulling, cluster);
+			clusters.push_back(cluster);
+		}
+	};
+	auto start = [&](size_t first) {
+		cluster = MeshCluster();
+		cluster.firstIndex = static_cast<GLuint>(first);
+		clusterVertices = 0;
+		normalSum[0] = normalSum[1] = normalSum[2] = 0.0f;
+		lastStamp++;
+	};
+
+	start(firstIndex);
+	for (size_t t = firstIndex; t + 2 < end; t += 3) {
+		size_t newVertices = 0;
+		for (int k = 0; k < 3; k++) {
+			newVertices += (vertexStamps[indices[t + k]] != lastStamp);
+		}
+
+		GLfloat normal[3];
+		getTriangleNormal(&vertices[indices[t] * floatsPerVertex + positionOffset],
+			&vertices[indices[t + 1] * floatsPerVertex + positionOffset],
+			&vertices[indices[t + 2] * floatsPerVertex + positionOffset], normal);
+
+		const size_t triangles = cluster.indexCount / 3;
+		bool split = triangles == MAX_TRIANGLES || clusterVertices + newVertices > MAX_VERTICES;
+		if (!split && triangles >= MIN_TRIANGLES) {
+			GLfloat length = sqrt(normalSum[0] * normalSum[0] + normalSum[1] * normalSum[1]
+				+ normalSum[2] * normalSum[2]);
+			GLfloat dot = normal[0] * normalSum[0] + normal[1] * normalSum[1] + normal[2] * normalSum[2];
+			split = dot < CONE_SPLIT * length;
+		}
+		if (split) {
+			finish();
+			start(t);
+		}
+
+		for (int k = 0; k < 3; k++) {
+			if (vertexStamps[indices[t + k]] != lastStamp) {
+				vertexStamps[indices[t + k]] = lastStamp;
+				clusterVertices++;
+			}
+			normalSum[k] += normal[k];
+		}
+		cluster.indexCount += 3;
+	}
+	finish();
+}
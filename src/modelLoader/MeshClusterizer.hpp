@@ -0,0 +1,52 @@
+/**
+* @file MeshClusterizer.hpp
+* @brief Splits an index buffer into small clusters with culling bounds.
+*
+* Clusters (meshlets) are consecutive runs of triangles in the existing
+* index order, so building them does not reorder anything. After the
+* vertex cache pass that order is already local, and a cluster is closed
+* when it reaches MAX_TRIANGLES or MAX_VERTICES or when the next triangle
+* would widen its normal cone past CONE_SPLIT.
+*
+* Each cluster gets a bounding sphere for frustum culling and a normal
+* cone for back-face culling, both in model space (see ClusterCulling).
+*/
+
+#pragma once
+
+#include "Mesh.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+
+namespace MeshClusterizer {
+	const size_t MAX_TRIANGLES = 124;
+	const size_t MAX_VERTICES = 64;
+	const size_t MIN_TRIANGLES = 32;   // clusters are not split for their cone below this
+	const GLfloat CONE_SPLIT = 0.5f;   // least cos(angle) between a triangle and the cluster normal
+	const GLfloat CONE_MIN_DOT = 0.1f; // wider cones are never back-facing as a whole
+
+	/**
+	* @brief Tells whether every position edge has exactly one opposite
+	* half-edge, i.e. the surface is closed and consistently wound.
+	*
+	* Only for closed meshes are back-facing clusters hidden by the front,
+	* so cones are disabled for open ones.
+	*/
+	bool isClosed(const std::vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+		const std::vector<GLuint> &indices, size_t firstIndex, size_t indexCount);
+
+	/**
+	* @brief Appends the clusters of indices [firstIndex, firstIndex + indexCount).
+	*
+	* With `coneCulling` false the clusters get a cone that never culls.
+	*
+	* `vertexStamps` (one zeroed entry per vertex) and `lastStamp` mark the
+	* vertices of the open cluster. They carry over between calls, the
+	* stamp only counts up, so they are allocated once per mesh and not
+	* once per submesh and level.
+	*/
+	void buildClusters(const std::vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+		const std::vector<GLuint> &indices, size_t firstIndex, size_t indexCount, bool coneCulling,
+		std::vector<GLuint> &vertexStamps, GLuint &lastStamp, std::vector<MeshCluster> &clusters);
+}
@@ -0,0 +1,158 @@
+#include "MeshOptimizer.hpp"
+#include "MeshAnalysis.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+static const long NO_VERTEX = -1;
+
+/**
+* @brief Picks the next fanning vertex for Tipsify.
+*
+* Prefers a vertex touched by the last fan that still has triangles left
+* and will still be cached after emitting them; otherwise falls back to
+* the most recent dead-end vertex, then to the next vertex in order.
+*/
+static long getNextVertex(const vector<GLuint> &candidates, const vector<unsigned> &live,
+	const vector<unsigned> &stamp, unsigned time, vector<GLuint> &deadEnds, size_t &cursor)
+{
+	const long cacheSize = static_cast<long>(MeshOptimizer::CACHE_SIZE);
+	long best = NO_VERTEX;
+	long bestPriority = -1;
+
+	for (GLuint v : candidates) {
+		if (live[v] == 0) {
+			continue;
+		}
+
+		// age in the cache after its remaining triangles are emitted
+		long age = static_cast<long>(time - stamp[v]);
+		long priority = (age + 2 * static_cast<long>(live[v]) <= cacheSize) ? age : 0;
+		if (priority > bestPriority) {
+			bestPriority = priority;
+			best = v;
+		}
+	}
+	if (best != NO_VERTEX) {
+		return best;
+	}
+
+	while (!deadEnds.empty()) {
+		GLuint v = deadEnds.back();
+		deadEnds.pop_back();
+		if (live[v] > 0) {
+			return v;
+		}
+	}
+
+	for (; cursor < live.size(); cursor++) {
+		if (live[cursor] > 0) {
+			return static_cast<long>(cursor);
+		}
+	}
+	return NO_VERTEX;
+}
+
+/**
+* @brief Reorders triangles for post-transform vertex cache reuse.
+*
+* Tipsify emits all remaining triangles around one vertex (a fan), then
+* moves on to a neighbour that is still in the simulated FIFO cache.
+* It runs in linear time. The original order is kept when it already
+* simulates better, which happens for meshes exported in strip order.
+*/
+void MeshOptimizer::optimizeVertexCache(vector<GLuint> &indices, size_t vertexCount) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return;
+	}
+
+	// vertex -> triangle adjacency (CSR)
+	vector<unsigned> live(vertexCount, 0);
+	for (GLuint index : indices) {
+		live[index]++;
+	}
+	vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+	}
+	vector<uint32_t> adjacency(indices.size());
+	{
+		vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++) {
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	vector<unsigned> stamp(vertexCount, 0);
+	vector<bool> emitted(triangleCount, false);
+	vector<GLuint> deadEnds, candidates, output;
+	output.reserve(indices.size());
+
+	// start the clock past the cache size so no vertex looks cached initially
+	unsigned time = CACHE_SIZE + 1;
+	size_t cursor = 0;
+	long fan = 0;
+
+	while (fan != NO_VERTEX) {
+		candidates.clear();
+
+		for (size_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++) {
+			uint32_t t = adjacency[a];
+			if (emitted[t]) {
+				continue;
+			}
+			emitted[t] = true;
+
+			for (int k = 0; k < 3; k++) {
+				GLuint v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - stamp[v] > CACHE_SIZE) {
+					// cache miss: the vertex enters the FIFO now
+					stamp[v] = time++;
+				}
+			}
+		}
+
+		fan = getNextVertex(candidates, live, stamp, time, deadEnds, cursor);
+	}
+
+	VertexCacheStats before = MeshAnalysis::analyzeVertexCache(indices, vertexCount, CACHE_SIZE);
+	VertexCacheStats after = MeshAnalysis::analyzeVertexCache(output, vertexCount, CACHE_SIZE);
+	if (after.acmr < before.acmr) {
+		indices.swap(output);
+	}
+}
+
+/**
+* @brief Renumbers vertices in first-use order of the index buffer.
+*
+* Vertices that no triangle references are dropped.
+*/
+void MeshOptimizer::optimizeVertexFetch(vector<GLfloat> &vertices, vector<GLuint> &indices, size_t floatsPerVertex) {
+	const size_t vertexCount = vertices.size() / floatsPerVertex;
+	const GLuint UNUSED = 0xFFFFFFFFu;
+
+	vector<GLuint> remap(vertexCount, UNUSED);
+	vector<GLfloat> reordered;
+	reordered.reserve(vertices.size());
+	GLuint nextVertex = 0;
+
+	for (GLuint &index : indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = nextVertex++;
+			const GLfloat *source = &vertices[index * floatsPerVertex];
+			reordered.insert(reordered.end(), source, source + floatsPerVertex);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
@@ -0,0 +1,27 @@
+/**
+* @file MeshOptimizer.hpp
+* @brief Reordering passes that make an indexed mesh cheaper to draw.
+*
+* - optimizeVertexCache: reorders triangles so consecutive triangles share
+*   vertices while they are still in the post-transform cache
+*   (Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex
+*   Locality and Reduced Overdraw" - the Tipsify pass).
+* - optimizeVertexFetch: renumbers vertices in the order the index buffer
+*   first uses them, so vertex fetches walk the VBO mostly forward.
+*
+* Both passes only permute data; the set of triangles is unchanged.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+
+namespace MeshOptimizer {
+	// FIFO size the reordering targets, same model as MeshAnalysis
+	const size_t CACHE_SIZE = 32;
+
+	void optimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount);
+	void optimizeVertexFetch(std::vector<GLfloat> &vertices, std::vector<GLuint> &indices, size_t floatsPerVertex);
+}
@@ -0,0 +1,295 @@
+#include "MeshSimplifier.hpp"
+#include "VertexWelder.hpp"
+#include "MeshTopology.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+	struct Vec3 {
+		double x, y, z;
+	};
+
+	Vec3 sub(const Vec3 &a, const Vec3 &b) {
+		return {a.x - b.x, a.y - b.y, a.z - b.z};
+	}
+
+	Vec3 cross(const Vec3 &a, const Vec3 &b) {
+		return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+	}
+
+	double dot(const Vec3 &a, const Vec3 &b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	/**
+	* Symmetric 4x4 plane quadric (xx, xy, xz, xw, yy, yz, yw, zz, zw, ww)
+	* plus the accumulated plane weight, used to normalize the error.
+	*/
+	struct Quadric {
+		array<double, 10> q = {};
+		double weight = 0.0;
+
+		void addPlane(const Vec3 &n, double d, double w) {
+			const double p[4] = {n.x, n.y, n.z, d};
+			int k = 0;
+			for (int i = 0; i < 4; i++) {
+				for (int j = i; j < 4; j++) {
+					q[k++] += w * p[i] * p[j];
+				}
+			}
+			weight += w;
+		}
+
+		void add(const Quadric &other) {
+			for (int k = 0; k < 10; k++) {
+				q[k] += other.q[k];
+			}
+			weight += other.weight;
+		}
+
+		// v^T Q v with v = (x, y, z, 1)
+		double evaluate(const Vec3 &v) const {
+			return q[0] * v.x * v.x + 2 * q[1] * v.x * v.y + 2 * q[2] * v.x * v.z + 2 * q[3] * v.x
+				+ q[4] * v.y * v.y + 2 * q[5] * v.y * v.z + 2 * q[6] * v.y
+				+ q[7] * v.z * v.z + 2 * q[8] * v.z
+				+ q[9];
+		}
+	};
+
+	struct Collapse {
+		GLuint from;
+		GLuint to;
+		double error;  // mean squared plane distance
+	};
+}
+
+/**
+* @brief Flags the vertices that must not be removed.
+*
+* Works on positions, so vertices that share a position but differ in
+* UV or color (seams) are all locked, as are vertices on edges without
+* exactly one opposite half-edge (borders, non-manifold edges).
+*/
+static vector<bool> findLockedVertices(const vector<GLuint> &positionOf, const vector<GLuint> &positionUse,
+	const vector<GLuint> &indices)
+{
+	const size_t vertexCount = positionOf.size();
+	vector<bool> lockedPosition(positionUse.size(), false);
+
+	// directed position edges, sorted; a manifold interior edge occurs
+	// once in each direction
+	vector<uint64_t> edges;
+	edges.reserve(indices.size());
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint64_t a = positionOf[indices[t + k]];
+			uint64_t b = positionOf[indices[t + (k + 1) % 3]];
+			edges.push_back(a << 32 | b);
+		}
+	}
+	sort(edges.begin(), edges.end());
+
+	for (size_t i = 0; i < edges.size();) {
+		size_t j = i + 1;
+		while (j < edges.size() && edges[j] == edges[i]) {
+			j++;
+		}
+		GLuint a = static_cast<GLuint>(edges[i] >> 32);
+		GLuint b = static_cast<GLuint>(edges[i]);
+		uint64_t opposite = static_cast<uint64_t>(b) << 32 | a;
+		auto range = equal_range(edges.begin(), edges.end(), opposite);
+		if (j - i != 1 || range.second - range.first != 1) {
+			lockedPosition[a] = true;
+			lockedPosition[b] = true;
+		}
+		i = j;
+	}
+
+	vector<bool> locked(vertexCount, false);
+	for (size_t v = 0; v < vertexCount; v++) {
+		locked[v] = lockedPosition[positionOf[v]] || positionUse[positionOf[v]] > 1;
+	}
+	return locked;
+}
+
+vector<GLuint> MeshSimplifier::simplify(const vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+	const vector<GLuint> &indices, size_t targetIndexCount, GLfloat maxError, GLfloat &resultError)
+{
+	const size_t vertexCount = vertices.size() / floatsPerVertex;
+	resultError = 0.0f;
+
+	vector<Vec3> positions(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		const GLfloat *p = &vertices[v * floatsPerVertex + positionOffset];
+		positions[v] = {p[0], p[1], p[2]};
+	}
+
+	// group vertices by exact position, keyed on the float bit patterns
+	vector<GLuint> positionOf(vertexCount);
+	vector<GLuint> positionUse;
+	{
+		VertexWelder welder(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) {
+			const GLfloat *p = &vertices[v * floatsPerVertex + positionOffset];
+			VertexKey key;
+			memcpy(&key.v, &p[0], sizeof(GLuint));
+			memcpy(&key.vt, &p[1], sizeof(GLuint));
+			memcpy(&key.vn, &p[2], sizeof(GLuint));
+
+			bool inserted;
+			positionOf[v] = welder.weld(key, inserted);
+			if (inserted) {
+				positionUse.push_back(0);
+			}
+			positionUse[positionOf[v]]++;
+		}
+	}
+
+	vector<bool> locked = findLockedVertices(positionOf, positionUse, indices);
+
+	// area weighted plane quadrics of the incident triangles
+	vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		const Vec3 &p0 = positions[indices[t]];
+		Vec3 n = cross(sub(positions[indices[t + 1]], p0), sub(positions[indices[t + 2]], p0));
+		double length = sqrt(dot(n, n));
+		if (length <= 0.0) {
+			continue;
+		}
+		Vec3 unit = {n.x / length, n.y / length, n.z / length};
+		double area = length * 0.5;
+		for (int k = 0; k < 3; k++) {
+			quadrics[indices[t + k]].addPlane(unit, -dot(unit, p0), area);
+		}
+	}
+
+	const double maxErrorSquared = static_cast<double>(maxError) * maxError;
+	vector<GLuint> result = indices;
+	vector<GLuint> remap(vertexCount);
+	vector<bool> touched(vertexCount);
+	// vertex -> triangle adjacency of the current mesh, rebuilt after every pass
+	MeshTopology topology(result, vertexCount);
+	vector<Collapse> best(vertexCount);
+	vector<Collapse> candidates;
+
+	while (result.size() > targetIndexCount) {
+		const size_t triangleCount = result.size() / 3;
+
+		// cheapest half-edge of every vertex that may be removed
+		for (size_t v = 0; v < vertexCount; v++) {
+			best[v] = {static_cast<GLuint>(v), static_cast<GLuint>(v), HUGE_VAL};
+		}
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++) {
+				GLuint from = result[t * 3 + k];
+				GLuint to = result[t * 3 + (k + 1) % 3];
+				if (locked[from]) {
+					continue;
+				}
+				double weight = quadrics[from].weight + quadrics[to].weight;
+				double error = quadrics[from].evaluate(positions[to]) + quadrics[to].evaluate(positions[to]);
+				error = (weight > 0.0) ? max(error, 0.0) / weight : 0.0;
+				if (error < best[from].error) {
+					best[from] = {from, to, error};
+				}
+			}
+		}
+		candidates.clear();
+		for (const Collapse &c : best) {
+			if (c.from != c.to) {
+				candidates.push_back(c);
+			}
+		}
+		sort(candidates.begin(), candidates.end(), [](const Collapse &a, const Collapse &b) {
+			return a.error < b.error;
+		});
+
+		for (size_t v = 0; v < vertexCount; v++) {
+			remap[v] = static_cast<GLuint>(v);
+		}
+		fill(touched.begin(), touched.end(), false);
+
+		const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t removed = 0;
+		size_t collapses = 0;
+
+		for (const Collapse &c : candidates) {
+			if (c.error > maxErrorSquared || removed >= trianglesToRemove) {
+				break;
+			}
+			if (touched[c.from] || touched[c.to]) {
+				continue;
+			}
+
+			// reject collapses that flip a remaining triangle around `from`
+			bool flips = false;
+			size_t shared = 0;
+			for (GLuint face : topology.getFaces(c.from)) {
+				const GLuint *tri = &result[face * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					shared++;
+					continue;
+				}
+
+				Vec3 before[3], after[3];
+				for (int k = 0; k < 3; k++) {
+					before[k] = positions[tri[k]];
+					after[k] = positions[tri[k] == c.from ? c.to : tri[k]];
+				}
+				Vec3 n0 = cross(sub(before[1], before[0]), sub(before[2], before[0]));
+				Vec3 n1 = cross(sub(after[1], after[0]), sub(after[2], after[0]));
+				if (dot(n0, n1) <= 0.0) {
+					flips = true;
+					break;
+				}
+			}
+			if (flips) {
+				continue;
+			}
+
+			remap[c.from] = c.to;
+			quadrics[c.to].add(quadrics[c.from]);
+			resultError = max(resultError, static_cast<GLfloat>(sqrt(c.error)));
+			removed += shared;
+			collapses++;
+
+			// the neighbourhood of `from` changed, leave it for the next pass
+			touched[c.to] = true;
+			for (GLuint face : topology.getFaces(c.from)) {
+				const GLuint *tri = &result[face * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+
+		if (collapses == 0) {
+			break;
+		}
+
+		// apply the collapses and drop triangles that became degenerate
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			GLuint a = remap[result[t * 3]];
+			GLuint b = remap[result[t * 3 + 1]];
+			GLuint c = remap[result[t * 3 + 2]];
+			if (a == b || b == c || a == c) {
+				continue;
+			}
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+		if (result.size() > targetIndexCount) {
+			topology.rebuild(result, vertexCount);
+		}
+	}
+
+	return result;
+}
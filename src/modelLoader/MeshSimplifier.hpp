@@ -0,0 +1,37 @@
+/**
+* @file MeshSimplifier.hpp
+* @brief Quadric error edge-collapse simplification for level-of-detail meshes.
+*
+* Edges are collapsed onto one of their existing vertices (half-edge
+* collapse) in order of quadric error (Garland, Heckbert, "Surface
+* Simplification Using Quadric Error Metrics"). Because no vertex is
+* moved or created, every level of detail indexes the same vertex buffer
+* and only needs its own index range.
+*
+* Vertices on open borders, on attribute seams (several vertices at one
+* position) and on non-manifold edges are never removed, which keeps
+* silhouettes and UV/color seams intact.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+
+namespace MeshSimplifier {
+	/**
+	* @brief Simplifies an indexed triangle list.
+	*
+	* Stops at `targetIndexCount` indices or when the next collapse would
+	* exceed `maxError`, whichever comes first.
+	*
+	* @param vertices Float build buffer, `floatsPerVertex` floats per vertex,
+	*                 position at `positionOffset`.
+	* @param resultError Largest error of an applied collapse, as an RMS
+	*                    distance in model units.
+	* @return Index buffer into the same vertices.
+	*/
+	std::vector<GLuint> simplify(const std::vector<GLfloat> &vertices, size_t floatsPerVertex, size_t positionOffset,
+		const std::vector<GLuint> &indices, size_t targetIndexCount, GLfloat maxError, GLfloat &resultError);
+}
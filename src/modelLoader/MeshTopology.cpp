@@ -0,0 +1,52 @@
+#include "MeshTopology.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <span>
+#include <memory_resource>
+
+using namespace std;
+
+MeshTopology::MeshTopology(span<const GLuint> indices, size_t vertexCount, pmr::memory_resource *resource) :
+	_offsets(resource), _faces(resource)
+{
+	rebuild(indices, vertexCount);
+}
+
+/**
+* @brief Recomputes the adjacency, reusing the allocated arrays.
+*
+* Counting sort in two passes: corners per vertex, prefix sum, then the
+* faces are dropped into their slots in face order.
+*/
+void MeshTopology::rebuild(span<const GLuint> indices, size_t vertexCount) {
+	const size_t faceCount = indices.size() / 3;
+	_offsets.assign(vertexCount + 1, 0);
+	for (size_t i = 0; i < faceCount * 3; i++) {
+		_offsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++) {
+		_offsets[v + 1] += _offsets[v];
+	}
+
+	_faces.resize(faceCount * 3);
+	pmr::vector<GLuint> cursor(_offsets.begin(), _offsets.end() - 1, _offsets.get_allocator());
+	for (size_t f = 0; f < faceCount; f++) {
+		for (int k = 0; k < 3; k++) {
+			_faces[cursor[indices[f * 3 + k]]++] = static_cast<GLuint>(f);
+		}
+	}
+}
+
+// getters //
+
+span<const GLuint> MeshTopology::getFaces(size_t vertex) const {
+	return span<const GLuint>(_faces.data() + _offsets[vertex], _offsets[vertex + 1] - _offsets[vertex]);
+}
+
+size_t MeshTopology::getVertexCount() const {
+	return _offsets.empty() ? 0 : _offsets.size() - 1;
+}
+
+size_t MeshTopology::getFaceCount() const {
+	return _faces.size() / 3;
+}
@@ -0,0 +1,38 @@
+/**
+* @file MeshTopology.hpp
+* @brief Vertex to face adjacency of an indexed triangle list.
+*
+* Stored in compressed sparse row form: the faces of vertex v are
+* faces[offsets[v] .. offsets[v + 1]), in ascending face order. A face
+* that uses a vertex twice (degenerate) is listed twice, once per corner.
+*
+* Iterating the faces of a vertex visits them in the order a loop over
+* all faces would, so gathers over this adjacency give the same floating
+* point sums as the equivalent scatter.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <span>
+#include <memory_resource>
+#include <cstddef>
+
+class MeshTopology {
+public:
+	MeshTopology(std::span<const GLuint> indices, size_t vertexCount,
+		std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+	void rebuild(std::span<const GLuint> indices, size_t vertexCount);
+
+	std::span<const GLuint> getFaces(size_t vertex) const;
+	size_t getVertexCount() const;
+	size_t getFaceCount() const;
+
+private:
+	std::pmr::vector<GLuint> _offsets;  // vertexCount + 1 entries
+	std::pmr::vector<GLuint> _faces;    // one entry per corner
+
+	MeshTopology();
+};
@@ -0,0 +1,149 @@
+/**
+* @file OBJScanner.hpp
+* @brief Locale-free, in-place number scanning for OBJ records.
+*
+* All functions work on [p, end) character ranges of a record and never
+* copy or allocate. Floats go through std::from_chars, which ignores the
+* global locale; face indices use a plain decimal digit loop.
+*
+* Scanning functions report problems through ScanStatus instead of
+* throwing, the loader decides which exception a status maps to.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+
+/**
+* @struct FaceVertex
+* @brief One v/vt/vn corner of a face record, already converted to
+* zero-based indices. Components missing from the token are flagged
+* in `has`.
+*/
+struct FaceVertex {
+	GLuint idx[3] = {0, 0, 0};  // v, vt, vn
+	bool has[3] = {false, false, false};
+};
+
+namespace OBJScanner {
+	enum ScanStatus {
+		SCAN_OK,
+		SCAN_INVALID,       // no digits where an index was expected
+		SCAN_OUT_OF_RANGE,  // index does not fit into 32 bits
+	};
+
+	inline bool isBlank(char c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	inline const char *skipBlanks(const char *p, const char *end) {
+		while (p != end && isBlank(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	inline const char *findBlank(const char *p, const char *end) {
+		while (p != end && !isBlank(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	// end of [p, end) without its trailing blanks
+	inline const char *trimBlanks(const char *p, const char *end) {
+		while (end != p && isBlank(end[-1])) {
+			--end;
+		}
+		return end;
+	}
+
+	/**
+	* @brief Reads the next float of a record and advances past it.
+	* @return false if no number starts at the cursor; value is left as is.
+	*/
+	inline bool scanFloat(const char *&p, const char *end, GLfloat &value) {
+		p = skipBlanks(p, end);
+		if (p != end && *p == '+') {
+			++p;
+		}
+
+		std::from_chars_result res = std::from_chars(p, end, value);
+		if (res.ec != std::errc()) {
+			return false;
+		}
+		p = res.ptr;
+		return true;
+	}
+
+	/**
+	* @brief Reads up to `count` floats, stopping at the first failure.
+	*
+	* Values that could not be read are set to 0, the same result a
+	* failed stream extraction gives.
+	*/
+	inline void scanFloats(const char *p, const char *end, GLfloat *values, int count) {
+		int i = 0;
+		while (i < count && scanFloat(p, end, values[i])) {
+			i++;
+		}
+		for (; i < count; i++) {
+			values[i] = 0.0f;
+		}
+	}
+
+	/**
+	* @brief Decodes a one-based OBJ index in [p, end).
+	*
+	* Leading digits are consumed and anything after them is ignored,
+	* which matches what stoul() accepted before. The result is zero-based,
+	* index 0 wraps around and is rejected later as out of range.
+	*/
+	inline ScanStatus scanIndex(const char *p, const char *end, GLuint &index) {
+		if (p == end || static_cast<unsigned char>(*p - '0') > 9) {
+			return SCAN_INVALID;
+		}
+
+		uint64_t value = 0;
+		for (; p != end && static_cast<unsigned char>(*p - '0') <= 9; ++p) {
+			value = value * 10 + static_cast<unsigned>(*p - '0');
+			if (value > UINT32_MAX) {
+				return SCAN_OUT_OF_RANGE;
+			}
+		}
+
+		index = static_cast<GLuint>(value - 1);
+		return SCAN_OK;
+	}
+
+	/**
+	* @brief Converts one face token (v, v/vt, v//vn, v/vt/vn) in place.
+	*
+	* Empty components are flagged as missing, the third component runs
+	* to the end of the token.
+	*/
+	inline ScanStatus scanFaceVertex(const char *p, const char *end, FaceVertex &corner) {
+		for (int k = 0; k < 3 && p != end; k++) {
+			const char *slash = (k < 2) ? static_cast<const char *>(memchr(p, '/', end - p)) : nullptr;
+			const char *compEnd = slash ? slash : end;
+
+			if (compEnd != p) {
+				ScanStatus status = scanIndex(p, compEnd, corner.idx[k]);
+				if (status != SCAN_OK) {
+					return status;
+				}
+				corner.has[k] = true;
+			}
+
+			if (compEnd == end) {
+				break;
+			}
+			p = compEnd + 1;
+		}
+
+		return SCAN_OK;
+	}
+}
@@ -0,0 +1,137 @@
+#include "PositionArrays.hpp"
+#include <glad/gl.h>
+#include <algorithm>
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+	#define POSITION_KERNELS_X86 1
+	#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/**
+* The vector kernels keep the accumulator as the second operand of
+* min/max, which then returns exactly what std::min(acc, v) and
+* std::max(acc, v) return, and leave the tail to the scalar loop.
+*/
+
+static void expandRangeScalar(const GLfloat *values, size_t count, GLfloat &low, GLfloat &high) {
+	for (size_t i = 0; i < count; i++) {
+		low = min(low, values[i]);
+		high = max(high, values[i]);
+	}
+}
+
+static void subtractScalar(GLfloat *values, size_t count, GLfloat offset) {
+	for (size_t i = 0; i < count; i++) {
+		values[i] -= offset;
+	}
+}
+
+#ifdef POSITION_KERNELS_X86
+
+static void expandRangeSSE(const GLfloat *values, size_t count, GLfloat &low, GLfloat &high) {
+	__m128 low0 = _mm_set1_ps(low), low1 = low0;
+	__m128 high0 = _mm_set1_ps(high), high1 = high0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128 a = _mm_loadu_ps(values + i);
+		__m128 b = _mm_loadu_ps(values + i + 4);
+		low0 = _mm_min_ps(a, low0);
+		low1 = _mm_min_ps(b, low1);
+		high0 = _mm_max_ps(a, high0);
+		high1 = _mm_max_ps(b, high1);
+	}
+
+	alignas(16) GLfloat lows[8], highs[8];
+	_mm_store_ps(lows, low0);
+	_mm_store_ps(lows + 4, low1);
+	_mm_store_ps(highs, high0);
+	_mm_store_ps(highs + 4, high1);
+	for (int k = 0; k < 8; k++) {
+		low = min(low, lows[k]);
+		high = max(high, highs[k]);
+	}
+	expandRangeScalar(values + i, count - i, low, high);
+}
+
+static void subtractSSE(GLfloat *values, size_t count, GLfloat offset) {
+	const __m128 delta = _mm_set1_ps(offset);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(values + i, _mm_sub_ps(_mm_loadu_ps(values + i), delta));
+	}
+	subtractScalar(values + i, count - i, offset);
+}
+
+__attribute__((target("avx2")))
+static void expandRangeAVX2(const GLfloat *values, size_t count, GLfloat &low, GLfloat &high) {
+	__m256 low0 = _mm256_set1_ps(low), low1 = low0;
+	__m256 high0 = _mm256_set1_ps(high), high1 = high0;
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256 a = _mm256_loadu_ps(values + i);
+		__m256 b = _mm256_loadu_ps(values + i + 8);
+		low0 = _mm256_min_ps(a, low0);
+		low1 = _mm256_min_ps(b, low1);
+		high0 = _mm256_max_ps(a, high0);
+		high1 = _mm256_max_ps(b, high1);
+	}
+
+	alignas(32) GLfloat lows[16], highs[16];
+	_mm256_store_ps(lows, low0);
+	_mm256_store_ps(lows + 8, low1);
+	_mm256_store_ps(highs, high0);
+	_mm256_store_ps(highs + 8, high1);
+	for (int k = 0; k < 16; k++) {
+		low = min(low, lows[k]);
+		high = max(high, highs[k]);
+	}
+	expandRangeScalar(values + i, count - i, low, high);
+}
+
+__attribute__((target("avx2")))
+static void subtractAVX2(GLfloat *values, size_t count, GLfloat offset) {
+	const __m256 delta = _mm256_set1_ps(offset);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(values + i, _mm256_sub_ps(_mm256_loadu_ps(values + i), delta));
+	}
+	subtractScalar(values + i, count - i, offset);
+}
+
+#endif
+
+struct KernelTable {
+	void (*expandRange)(const GLfloat *, size_t, GLfloat &, GLfloat &);
+	void (*subtract)(GLfloat *, size_t, GLfloat);
+	const char *name;
+};
+
+// resolved once, on first use
+static const KernelTable &getKernels() {
+	static const KernelTable table = []() -> KernelTable {
+#ifdef POSITION_KERNELS_X86
+		if (__builtin_cpu_supports("avx2")) {
+			return {expandRangeAVX2, subtractAVX2, "AVX2"};
+		}
+		return {expandRangeSSE, subtractSSE, "SSE"};
+#else
+		return {expandRangeScalar, subtractScalar, "scalar"};
+#endif
+	}();
+	return table;
+}
+
+void PositionKernels::expandRange(const GLfloat *values, size_t count, GLfloat &min, GLfloat &max) {
+	getKernels().expandRange(values, count, min, max);
+}
+
+void PositionKernels::subtract(GLfloat *values, size_t count, GLfloat offset) {
+	getKernels().subtract(values, count, offset);
+}
+
+const char *PositionKernels::getInstructionSet() {
+	return getKernels().name;
+}
@@ -0,0 +1,103 @@
+/**
+* @file PositionArrays.hpp
+* @brief OBJ vertex positions in structure-of-arrays form.
+*
+* x, y and z live in separate 64-byte aligned arrays, so whole-model
+* passes (bounds, centering) stream through contiguous floats and map
+* directly onto vector registers. The kernels in PositionKernels work on
+* one such array at a time; they pick AVX2 or SSE at run time when the
+* CPU has it and fall back to a scalar loop elsewhere.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <memory_resource>
+#include <cstddef>
+
+/**
+* @brief Allocator that aligns every block to `Alignment` bytes (a cache
+* line by default), taken from a std::pmr memory resource.
+*/
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+	using value_type = T;
+
+	template <typename U>
+	struct rebind {
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	std::pmr::memory_resource *resource = std::pmr::get_default_resource();
+
+	AlignedAllocator() = default;
+	AlignedAllocator(std::pmr::memory_resource *source) : resource(source) {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment> &other) : resource(other.resource) {}
+
+	T *allocate(size_t count) {
+		return static_cast<T *>(resource->allocate(count * sizeof(T), Alignment));
+	}
+
+	void deallocate(T *pointer, size_t count) {
+		resource->deallocate(pointer, count * sizeof(T), Alignment);
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment> &other) const {
+		return *resource == *other.resource;
+	}
+};
+
+using AlignedFloats = std::vector<GLfloat, AlignedAllocator<GLfloat>>;
+
+/**
+* @struct PositionArrays
+* @brief One x, y and z per OBJ `v` record, in file order.
+*/
+struct PositionArrays {
+	AlignedFloats x;
+	AlignedFloats y;
+	AlignedFloats z;
+
+	explicit PositionArrays(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+		x(resource), y(resource), z(resource)
+	{}
+
+	size_t size() const { return x.size(); }
+	bool empty() const { return x.empty(); }
+
+	void append(GLfloat px, GLfloat py, GLfloat pz) {
+		x.push_back(px);
+		y.push_back(py);
+		z.push_back(pz);
+	}
+
+	void resize(size_t count) {
+		x.resize(count);
+		y.resize(count);
+		z.resize(count);
+	}
+};
+
+namespace PositionKernels {
+	/**
+	* @brief Widens [min, max] to enclose values[0 .. count).
+	*
+	* Same result as a std::min/std::max loop for every input without NaN.
+	*/
+	void expandRange(const GLfloat *values, size_t count, GLfloat &min, GLfloat &max);
+
+	/**
+	* @brief values[i] -= offset for i in [0, count), bit-identical to the
+	* scalar loop.
+	*/
+	void subtract(GLfloat *values, size_t count, GLfloat offset);
+
+	/**
+	* @return "AVX2", "SSE" or "scalar", the kernels this CPU runs.
+	*/
+	const char *getInstructionSet();
+}
@@ -1,20 +1,123 @@
 #include "RenderModelLoader.hpp"
+#include "OBJScanner.hpp"
+#include "VertexWelder.hpp"
+#include "MeshAnalysis.hpp"
+#include "MeshOptimizer.hpp"
+#include "VertexPacker.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshClusterizer.hpp"
+#include "MeshTopology.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include "../jobs/JobSystem.hpp"
 #include <exception>
 #include <string>
 #include <vector>
-#include <array>
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <glad/gl.h>
 #include <map>
 #include <algorithm>  // min/max
-#include <ctime> // time()
 #include <math.h> // fabs()
 #include <cmath> // sqrt()
+#include <cstring> // memchr()
+#include <string_view>
+#include <array>
+#include <memory_resource>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
 
 using namespace std;
 
+static const size_t POSITION_OFFSET = VERTEX_SEMANTICS[SEMANTIC_POSITION].sourceOffset;
+static const size_t TEXCOORD_OFFSET = VERTEX_SEMANTICS[SEMANTIC_TEXCOORD].sourceOffset;
+static const size_t COLOR_OFFSET = VERTEX_SEMANTICS[SEMANTIC_COLOR].sourceOffset;
+
+static const size_t LOOP_GRAIN = 16384;         // elements per parallelFor() range
+
+// runs `stage` and stores its wall time in `ms`
+template <typename Stage>
+static void timeStage(double &ms, Stage stage) {
+	auto start = chrono::steady_clock::now();
+	stage();
+	ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static const GLfloat LOD_MAX_ERROR = 0.1f;      // of the largest model extent
+static const GLfloat LOD_MIN_REDUCTION = 0.1f;  // fewer triangles a level must save
+
+// angle at `corner` of the triangle (corner, next, previous), in radians
+static GLfloat getCornerAngle(const GLfloat *corner, const GLfloat *next, const GLfloat *previous) {
+	const GLfloat a[3] = {next[0] - corner[0], next[1] - corner[1], next[2] - corner[2]};
+	const GLfloat b[3] = {previous[0] - corner[0], previous[1] - corner[1], previous[2] - corner[2]};
+	GLfloat lengths = sqrt((a[0] * a[0] + a[1] * a[1] + a[2] * a[2]) * (b[0] * b[0] + b[1] * b[1] + b[2] * b[2]));
+	if (lengths <= 0.0f) {
+		return 0.0f;
+	}
+	return acos(clamp((a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / lengths, -1.0f, 1.0f));
+}
+
+static const GLuint NO_VERTEX = UINT32_MAX;
+
+/**
+* @struct LocalSubmesh
+* @brief The indices of one submesh with its vertices renumbered 0..n-1
+* in first-use order, and the way back.
+*
+* Vertex cache optimization and simplification are linear in the vertex
+* count, so on its own numbering a submesh costs as much as its size.
+*/
+struct LocalSubmesh {
+	vector<GLuint> indices;
+	vector<GLuint> vertices;  // local -> mesh vertex
+
+	// `localOf` maps mesh -> local vertices, all NO_VERTEX before and after
+	LocalSubmesh(const GLuint *meshIndices, size_t count, vector<GLuint> &localOf) : indices(count) {
+		for (size_t i = 0; i < count; i++) {
+			GLuint &local = localOf[meshIndices[i]];
+			if (local == NO_VERTEX) {
+				local = static_cast<GLuint>(vertices.size());
+				vertices.push_back(meshIndices[i]);
+			}
+			indices[i] = local;
+		}
+		for (GLuint vertex : vertices) {
+			localOf[vertex] = NO_VERTEX;
+		}
+	}
+
+	void toMesh(const vector<GLuint> &localIndices, GLuint *meshIndices) const {
+		for (size_t i = 0; i < localIndices.size(); i++) {
+			meshIndices[i] = vertices[localIndices[i]];
+		}
+	}
+};
+
+// vertex cache pass over one submesh, `indices` in mesh numbering
+static void optimizeSubmesh(GLuint *indices, size_t count, vector<GLuint> &localOf) {
+	LocalSubmesh local(indices, count, localOf);
+	MeshOptimizer::optimizeVertexCache(local.indices, local.vertices.size());
+	local.toMesh(local.indices, indices);
+}
+
+// simplifies one submesh, `indices` and the result in mesh numbering
+static vector<GLuint> simplifySubmesh(const vector<GLfloat> &vertices, const vector<GLuint> &indices,
+	size_t target, GLfloat maxError, GLfloat &error, vector<GLuint> &localOf)
+{
+	LocalSubmesh local(indices.data(), indices.size(), localOf);
+	vector<GLfloat> localVertices(local.vertices.size() * Mesh::FLOATS_PER_VERTEX);
+	for (size_t v = 0; v < local.vertices.size(); v++) {
+		copy_n(&vertices[local.vertices[v] * Mesh::FLOATS_PER_VERTEX], Mesh::FLOATS_PER_VERTEX,
+			&localVertices[v * Mesh::FLOATS_PER_VERTEX]);
+	}
+
+	vector<GLuint> lod = MeshSimplifier::simplify(localVertices, Mesh::FLOATS_PER_VERTEX, POSITION_OFFSET,
+		local.indices, target, maxError, error);
+	vector<GLuint> result(lod.size());
+	local.toMesh(lod, result.data());
+	return result;
+}
+
 RenderModelLoaderException::RenderModelLoaderException(ErrorCode err)
 	: _errorCode(err) {}
 
@@ -33,126 +136,356 @@ const char *RenderModelLoaderException::what() const noexcept {
 /**
 * @brief Loads and parses an OBJ file.
 * @param path Path to the OBJ file.
+* @param options Parser selection, see LoaderOptions.
 * @throws RenderModelLoaderException on file or parsing errors.
 */
-RenderModelLoader::RenderModelLoader(const string &path) :
-	_path(path)
+RenderModelLoader::RenderModelLoader(const string &path, const LoaderOptions &options) :
+	_raw(_scratch.getResource()), _path(path), _options(options),
+	_cache(path, options.vertexFormat, getCacheFlags(options), options.lodLevels)
 {
 	if (_path.empty()) {
 		throw RenderModelLoaderException(RenderModelLoaderException::FILE_NOT_FOUND);
 	}
 
-	parseOBJFile();
-	calculateNormals();
+	if (_options.useMeshCache && loadMeshCache()) {
+		return;
+	}
+
+	timeStage(_timings.parseMs, [this]() { parseOBJFile(); });
+	timeStage(_timings.normalsMs, [this]() { calculateNormals(); });
 
-	if (_raw.vertices.empty() || _raw.vIndices.empty()) {
+	if (_raw.positions.empty() || _raw.vIndices.empty()) {
 		throw RenderModelLoaderException(RenderModelLoaderException::UNKNOWN_ERROR);
 	}
 
-	buildMesh();
+	timeStage(_timings.boundsMs, [this]() {
+		calculateBoundingBox();
+		centerVertices();
+	});
+	timeStage(_timings.buildMs, [this]() { buildMesh(); });
+	releaseScratch();
+
+	if (_options.useMeshCache) {
+		storeMeshCache();
+	}
+}
+
+JobSystem &RenderModelLoader::getJobs() const {
+	return _options.jobs ? *_options.jobs : JobSystem::getShared();
+}
+
+uint32_t RenderModelLoader::getCacheFlags(const LoaderOptions &options) {
+	uint32_t flags = 0;
+	if (options.optimizeVertexCache) {
+		flags |= MeshCache::VERTEX_CACHE_OPTIMIZED;
+	}
+	if (options.normalWeighting == LoaderOptions::NORMALS_AREA) {
+		flags |= MeshCache::NORMALS_AREA_WEIGHTED;
+	} else if (options.normalWeighting == LoaderOptions::NORMALS_ANGLE) {
+		flags |= MeshCache::NORMALS_ANGLE_WEIGHTED;
+	}
+	return flags;
+}
+
+bool RenderModelLoader::loadMeshCache() {
+	if (!_cache.load()) {
+		return false;
+	}
+
+	MeshView view = _cache.getView();
+	if (view.vertices.empty() || view.indices.empty()) {
+		return false;
+	}
+
+	_bbox = _cache.getBounds();
+	_fromCache = true;
+	size_t fullIndices = view.lods.empty() ? view.indices.size() : view.lods[0].indexCount;
+	if (_options.printStats) {
+		cout << "Mesh loaded from cache " << _cache.getPath() << ": "
+			<< fullIndices / 3 << " triangles, "
+			<< view.getVertexCount() << " vertices, "
+			<< max<size_t>(1, view.lods.size()) << " LODs\n";
+	}
+	_buffers.emplace(move(_cache));
+	return true;
+}
+
+void RenderModelLoader::storeMeshCache() {
+	if (_cache.store(*_buffers)) {
+		if (_options.printStats) {
+			cout << "Mesh cache written to " << _cache.getPath() << "\n";
+		}
+	} else {
+		cout << "Mesh cache could not be written to " << _cache.getPath() << "\n";
+	}
+}
+
+/**
+* @brief Drops the parse data and returns all scratch memory of the load
+* at once, reporting how much the pool handed out.
+*/
+void RenderModelLoader::releaseScratch() {
+	_raw = RawOBJData(_scratch.getResource());
+	if (_options.printStats) {
+		cout << "  scratch: " << _scratch.getAllocationCount() << " allocations from "
+			<< _scratch.getHeapBlockCount() << " heap blocks, "
+			<< _scratch.getAllocatedBytes() / 1024 << " KiB\n";
+	}
+	_scratch.release();
+}
+
+pmr::vector<OBJChunk> RenderModelLoader::makeChunks(size_t count) {
+	pmr::vector<OBJChunk> chunks(_scratch.getResource());
+	chunks.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		chunks.push_back(OBJChunk{RawOBJData(_scratch.getResource())});
+	}
+	return chunks;
 }
 
 void RenderModelLoader::parseOBJFile() {
+	if (_options.parseMode != LoaderOptions::STREAM) {
+		try {
+			MappedFile file(_path);
+			parseMappedOBJFile(file.data(), file.size());
+			return;
+		} catch (const MappedFileException &e) {
+			if (e.getErrorCode() == MappedFileException::CANNOT_OPEN) {
+				throw RenderModelLoaderException(RenderModelLoaderException::CANNOT_OPEN);
+			}
+			// not a mappable file, read it as a stream instead
+		}
+	}
+
+	pmr::vector<OBJChunk> chunks = makeChunks(1);
+	parseStreamOBJFile(chunks[0]);
+	mergeChunks(chunks);
+}
+
+/**
+* @brief Reads the file line by line and decodes each line in place.
+*
+* Used when the file cannot be mapped. One line buffer is reused for
+* the whole file.
+*/
+void RenderModelLoader::parseStreamOBJFile(OBJChunk &chunk) {
 	ifstream file;
 	file.open(_path);
 	if (!file.is_open()) {
 		throw RenderModelLoaderException(RenderModelLoaderException::CANNOT_OPEN);
 	}
 
-	string line, type;
-	GLfloat x, y, z;
+	string line;
 	while (getline(file, line)) {
-		istringstream sline(line);
-		sline >> type;
-		if (type == "v") {
-			sline >> x >> y >> z;
-			_raw.vertices.push_back(x);
-			_raw.vertices.push_back(y);
-			_raw.vertices.push_back(z);
-			_raw.vertices.push_back(1.0);
-		} else if (type == "vt") {
-			sline >> x >> y;
-			_raw.texCoords.push_back(x);
-			_raw.texCoords.push_back(y);
-		} else if (type == "vn") {
-			sline >> x >> y >> z;
-			_raw.normals.push_back(x);
-			_raw.normals.push_back(y);
-			_raw.normals.push_back(z);
-		} else if (type == "f") {
-			parseFaces(sline);
-		} else if (type == "o") {
-			; // to implement later
-		} else if (type == "g") {
-			; // to implement later
-		} else if (type == "usemtl") {
-			; // to implement later
-		}
+		parseRecord(line.data(), line.data() + line.size(), chunk);
 	}
 
 	file.close();
 }
 
+/**
+* @brief Parses a mapped OBJ file, split into chunks in PARALLEL mode.
+*
+* Chunk boundaries are moved forward to the next newline so that every
+* record belongs to exactly one chunk. Each chunk is a JobSystem range
+* parsed into a private OBJChunk; if several chunks fail, the error of
+* the earliest one is reported, as a serial parse would.
+*/
+void RenderModelLoader::parseMappedOBJFile(const char *data, size_t size) {
+	const char *end = data + size;
+	size_t chunkCount = getChunkCount(size);
+
+	pmr::vector<const char *> bounds(chunkCount + 1, end, _scratch.getResource());
+	bounds[0] = data;
+	for (size_t i = 1; i < chunkCount; i++) {
+		const char *p = max(bounds[i - 1], data + size / chunkCount * i);
+		const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+		bounds[i] = eol ? eol + 1 : end;
+	}
+
+	pmr::vector<OBJChunk> chunks = makeChunks(chunkCount);
+	getJobs().parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			parseLines(bounds[i], bounds[i + 1], chunks[i]);
+		}
+	});
+
+	mergeChunks(chunks);
+}
+
+size_t RenderModelLoader::getChunkCount(size_t size) const {
+	if (_options.parseMode != LoaderOptions::PARALLEL) {
+		return 1;
+	}
+
+	size_t threads = _options.parseThreads ? _options.parseThreads : getJobs().getWorkerCount() + 1;
+	size_t bySize = size / max<size_t>(_options.minChunkSize, 1);
+	return max<size_t>(1, min(threads, bySize));
+}
+
+/**
+* @brief Validates deferred face indices and concatenates the chunks.
+*
+* A prefix sum over the element counts gives every chunk its base
+* vertex, texcoord and normal offsets (used to check the indices it
+* recorded) and the position of its data in the merged arrays. The
+* copies of the chunks into their slots run as JobSystem ranges.
+*
+* @throws RenderModelLoaderException if a face refers to an element
+* that is not defined before it.
+*/
+void RenderModelLoader::mergeChunks(pmr::vector<OBJChunk> &chunks) {
+	const size_t chunkCount = chunks.size();
+	int64_t base[3] = {0, 0, 0};
+	pmr::vector<array<size_t, 6>> offsets(chunkCount, _scratch.getResource());
+	array<size_t, 6> total = {0, 0, 0, 0, 0, 0};
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		RawOBJData &part = chunks[i].data;
+		const int64_t counts[3] = {
+			static_cast<int64_t>(part.positions.size()),
+			static_cast<int64_t>(part.texCoords.size() / 2),
+			static_cast<int64_t>(part.normals.size() / 3),
+		};
+
+		for (int k = 0; k < 3; k++) {
+			if (chunks[i].maxExcess[k] >= base[k]) {
+				throw RenderModelLoaderException(RenderModelLoaderException::INDEX_OUT_OF_RANGE);
+			}
+			base[k] += counts[k];
+		}
+
+		const size_t sizes[6] = {
+			part.positions.size(), part.texCoords.size(), part.normals.size(),
+			part.vIndices.size(), part.vtIndices.size(), part.vnIndices.size(),
+		};
+		for (int k = 0; k < 6; k++) {
+			offsets[i][k] = total[k];
+			total[k] += sizes[k];
+		}
+	}
+
+	// the first chunk already sits at offset 0
+	_raw = move(chunks[0].data);
+	if (chunkCount == 1) {
+		return;
+	}
+
+	_raw.positions.resize(total[0]);
+	_raw.texCoords.resize(total[1]);
+	_raw.normals.resize(total[2]);
+	_raw.vIndices.resize(total[3]);
+	_raw.vtIndices.resize(total[4]);
+	_raw.vnIndices.resize(total[5]);
+
+	getJobs().parallelFor(chunkCount - 1, 1, [this, &chunks, &offsets](size_t first, size_t last) {
+		for (size_t i = first + 1; i <= last; i++) {
+			const RawOBJData &part = chunks[i].data;
+			copy(part.positions.x.begin(), part.positions.x.end(), _raw.positions.x.begin() + offsets[i][0]);
+			copy(part.positions.y.begin(), part.positions.y.end(), _raw.positions.y.begin() + offsets[i][0]);
+			copy(part.positions.z.begin(), part.positions.z.end(), _raw.positions.z.begin() + offsets[i][0]);
+			copy(part.texCoords.begin(), part.texCoords.end(), _raw.texCoords.begin() + offsets[i][1]);
+			copy(part.normals.begin(), part.normals.end(), _raw.normals.begin() + offsets[i][2]);
+			copy(part.vIndices.begin(), part.vIndices.end(), _raw.vIndices.begin() + offsets[i][3]);
+			copy(part.vtIndices.begin(), part.vtIndices.end(), _raw.vtIndices.begin() + offsets[i][4]);
+			copy(part.vnIndices.begin(), part.vnIndices.end(), _raw.vnIndices.begin() + offsets[i][5]);
+		}
+	});
+
+	// group statements count the triangles of the whole file from here on
+	for (size_t i = 1; i < chunkCount; i++) {
+		for (OBJGroupRecord &record : chunks[i].data.groups) {
+			record.firstTriangle += offsets[i][3] / 3;
+			_raw.groups.push_back(move(record));
+		}
+	}
+}
+
+/**
+* @brief Per-range boxes merged in range order; min/max are exact, so the
+* result does not depend on how the vertices were split. Each range runs
+* the vector min/max kernel over the x, y and z arrays.
+*/
 void RenderModelLoader::calculateBoundingBox() {
-	for (size_t i = 0; i < _raw.vertices.size(); i += 4) {
-		_bbox.minX = min(_bbox.minX, _raw.vertices[i]);
-		_bbox.maxX = max(_bbox.maxX, _raw.vertices[i]);
-		_bbox.minY = min(_bbox.minY, _raw.vertices[i + 1]);
-		_bbox.maxY = max(_bbox.maxY, _raw.vertices[i + 1]);
-		_bbox.minZ = min(_bbox.minZ, _raw.vertices[i + 2]);
-		_bbox.maxZ = max(_bbox.maxZ, _raw.vertices[i + 2]);
+	const size_t vertexCount = _raw.positions.size();
+	const size_t ranges = max<size_t>(1, (vertexCount + LOOP_GRAIN - 1) / LOOP_GRAIN);
+	pmr::vector<BoundingBox> partial(ranges, _scratch.getResource());
+
+	getJobs().parallelFor(vertexCount, LOOP_GRAIN, [&](size_t first, size_t last) {
+		BoundingBox &box = partial[first / LOOP_GRAIN];
+		PositionKernels::expandRange(&_raw.positions.x[first], last - first, box.minX, box.maxX);
+		PositionKernels::expandRange(&_raw.positions.y[first], last - first, box.minY, box.maxY);
+		PositionKernels::expandRange(&_raw.positions.z[first], last - first, box.minZ, box.maxZ);
+	});
+
+	for (const BoundingBox &box : partial) {
+		_bbox.minX = min(_bbox.minX, box.minX);
+		_bbox.maxX = max(_bbox.maxX, box.maxX);
+		_bbox.minY = min(_bbox.minY, box.minY);
+		_bbox.maxY = max(_bbox.maxY, box.maxY);
+		_bbox.minZ = min(_bbox.minZ, box.minZ);
+		_bbox.maxZ = max(_bbox.maxZ, box.maxZ);
 	}
 }
 
-void RenderModelLoader::calculateCubicUV() {
+// gathers the x, y, z of OBJ vertex `vIdx` from the position arrays
+void RenderModelLoader::getPosition(GLuint vIdx, GLfloat *out) const {
+	out[0] = _raw.positions.x[vIdx];
+	out[1] = _raw.positions.y[vIdx];
+	out[2] = _raw.positions.z[vIdx];
+}
+
+/**
+* The helpers below only read shared state and write the vertex they are
+* given, so buildMesh() can call them from several threads. Positions
+* are read from the vertex, which holds them already.
+*/
+void RenderModelLoader::calculateCubicUV(const GLfloat *normal, GLfloat *vertex) const {
 	GLfloat u, v;
+	const GLfloat *position = &vertex[POSITION_OFFSET];
 
     // Find which axis the normal is most aligned with
-    GLfloat absNX = fabs(_nx);
-    GLfloat absNY = fabs(_ny);
-    GLfloat absNZ = fabs(_nz);
+    GLfloat absNX = fabs(normal[0]);
+    GLfloat absNY = fabs(normal[1]);
+    GLfloat absNZ = fabs(normal[2]);
 
     if (absNX >= absNY && absNX >= absNZ) {
         // X-dominant face - project from YZ plane
-        u = (_posZ - _bbox.minZ) / _bbox.getRangeZ();
-        v = (_posY - _bbox.minY) / _bbox.getRangeY();
+        u = (position[2] - _bbox.minZ) / _bbox.getRangeZ();
+        v = (position[1] - _bbox.minY) / _bbox.getRangeY();
     } else if (absNY >= absNX && absNY >= absNZ) {
         // Y-dominant face - project from XZ plane
-        u = (_posX - _bbox.minX) / _bbox.getRangeX();
-        v = (_posZ - _bbox.minZ) / _bbox.getRangeZ();
+        u = (position[0] - _bbox.minX) / _bbox.getRangeX();
+        v = (position[2] - _bbox.minZ) / _bbox.getRangeZ();
     } else {
         // Z-dominant face - project from XY plane
-        u = (_posX - _bbox.minX) / _bbox.getRangeX();
-        v = (_posY - _bbox.minY) / _bbox.getRangeY();
+        u = (position[0] - _bbox.minX) / _bbox.getRangeX();
+        v = (position[1] - _bbox.minY) / _bbox.getRangeY();
     }
 
-	_mesh.vertices.push_back(u);
-	_mesh.vertices.push_back(v);
+	vertex[TEXCOORD_OFFSET] = u;
+	vertex[TEXCOORD_OFFSET + 1] = v;
 }
 
-void RenderModelLoader::calculateUVCoordinates(GLuint vtIdx, GLuint vnIdx) {
+void RenderModelLoader::calculateUVCoordinates(GLuint vtIdx, GLuint vnIdx, GLfloat *vertex) const {
 	if (_raw.hasTexCoords() && vtIdx * 2 + 1 < _raw.texCoords.size()) {
-		_mesh.vertices.push_back(_raw.texCoords[vtIdx * 2]);
-		_mesh.vertices.push_back(_raw.texCoords[vtIdx * 2 + 1]);
+		vertex[TEXCOORD_OFFSET] = _raw.texCoords[vtIdx * 2];
+		vertex[TEXCOORD_OFFSET + 1] = _raw.texCoords[vtIdx * 2 + 1];
 	} else {
 		if (_raw.hasNormals() && vnIdx * 3 + 2 < _raw.normals.size()) {
 			// Use cubic/box mapping based on normal direction
-			_nx = _raw.normals[vnIdx * 3];
-            _ny = _raw.normals[vnIdx * 3 + 1];
-            _nz = _raw.normals[vnIdx * 3 + 2];
-
-			calculateCubicUV();
+			calculateCubicUV(&_raw.normals[vnIdx * 3], vertex);
 		} else {
 			// Fallback to simple planar mapping
-			GLfloat u = (_posX - _bbox.minX) / _bbox.getRangeX();
-			GLfloat v = (_posY - _bbox.minY) / _bbox.getRangeY();
-			_mesh.vertices.push_back(u);
-			_mesh.vertices.push_back(v);
+			GLfloat u = (vertex[POSITION_OFFSET] - _bbox.minX) / _bbox.getRangeX();
+			GLfloat v = (vertex[POSITION_OFFSET + 1] - _bbox.minY) / _bbox.getRangeY();
+			vertex[TEXCOORD_OFFSET] = u;
+			vertex[TEXCOORD_OFFSET + 1] = v;
 		}
 	}
 }
 
-void RenderModelLoader::calculateVertexColor(GLuint vnIdx) {
+void RenderModelLoader::calculateVertexColor(GLuint vnIdx, GLfloat *vertex) const {
 	// Color based on normal direction (to distinguish sides)
 	GLfloat r, g, b;
 	if (_raw.hasNormals() && vnIdx * 3 + 2 < _raw.normals.size()) {
@@ -168,100 +501,121 @@ void RenderModelLoader::calculateVertexColor(GLuint vnIdx) {
 		b = (nz + 1.0f) * 0.5f;
 	} else {
 		// Fallback: use position-based coloring
-		r = (_posX - _bbox.minX) / _bbox.getRangeX();
-		g = (_posY - _bbox.minY) / _bbox.getRangeY();
-		b = (_posZ - _bbox.minZ) / _bbox.getRangeZ();
+		r = (vertex[POSITION_OFFSET] - _bbox.minX) / _bbox.getRangeX();
+		g = (vertex[POSITION_OFFSET + 1] - _bbox.minY) / _bbox.getRangeY();
+		b = (vertex[POSITION_OFFSET + 2] - _bbox.minZ) / _bbox.getRangeZ();
 	}
 
-	_mesh.vertices.push_back(r);
-	_mesh.vertices.push_back(g);
-	_mesh.vertices.push_back(b);
+	vertex[COLOR_OFFSET] = r;
+	vertex[COLOR_OFFSET + 1] = g;
+	vertex[COLOR_OFFSET + 2] = b;
 }
 
+/**
+* @brief Vertex normals for models without them.
+*
+* Face normals are computed in parallel, then every vertex gathers the
+* normals of its faces through a MeshTopology, also in parallel. The
+* faces of a vertex are summed in face order, so the result does not
+* depend on the number of threads. `normalWeighting` selects how much
+* each face contributes: equally, by area or by the corner angle.
+*/
 void RenderModelLoader::calculateNormals() {
     if (!_raw.normals.empty()) {
         return;
     }
 
     std::cout << "No normals found, calculating from geometry...\n";
-
-    // Reserve space for per-vertex normals (initialized to zero)
-    _raw.normals.resize(_raw.vertices.size() / 4 * 3, 0.0f);
-    _raw.vnIndices.resize(_raw.vIndices.size());
-
-    // Calculate face normals and accumulate at vertices
-    for (size_t i = 0; i < _raw.vIndices.size(); i += 3) {
-        GLuint idx0 = _raw.vIndices[i];
-        GLuint idx1 = _raw.vIndices[i + 1];
-        GLuint idx2 = _raw.vIndices[i + 2];
-
-        // Get triangle vertices
-        GLfloat v0x = _raw.vertices[idx0 * 4];
-        GLfloat v0y = _raw.vertices[idx0 * 4 + 1];
-        GLfloat v0z = _raw.vertices[idx0 * 4 + 2];
-
-        GLfloat v1x = _raw.vertices[idx1 * 4];
-        GLfloat v1y = _raw.vertices[idx1 * 4 + 1];
-        GLfloat v1z = _raw.vertices[idx1 * 4 + 2];
-
-        GLfloat v2x = _raw.vertices[idx2 * 4];
-        GLfloat v2y = _raw.vertices[idx2 * 4 + 1];
-        GLfloat v2z = _raw.vertices[idx2 * 4 + 2];
-
-        // Calculate edge vectors
-        GLfloat e1x = v1x - v0x;
-        GLfloat e1y = v1y - v0y;
-        GLfloat e1z = v1z - v0z;
-
-        GLfloat e2x = v2x - v0x;
-        GLfloat e2y = v2y - v0y;
-        GLfloat e2z = v2z - v0z;
-
-        // Cross product: normal = e1 × e2
-        GLfloat nx = e1y * e2z - e1z * e2y;
-        GLfloat ny = e1z * e2x - e1x * e2z;
-        GLfloat nz = e1x * e2y - e1y * e2x;
-
-        // Normalize
-        GLfloat len = sqrt(nx*nx + ny*ny + nz*nz);
-        if (len > 0.0001f) {
-            nx /= len;
-            ny /= len;
-            nz /= len;
+    JobSystem &jobs = getJobs();
+    const LoaderOptions::NormalWeighting weighting = _options.normalWeighting;
+
+    const size_t vertexCount = _raw.positions.size();
+    const size_t faceCount = _raw.vIndices.size() / 3;
+    _raw.normals.resize(vertexCount * 3);
+    _raw.vnIndices = _raw.vIndices;  // normal indices are the vertex indices
+
+    pmr::vector<GLfloat> faceNormals(faceCount * 3, _scratch.getResource());
+    pmr::vector<GLfloat> cornerAngles(weighting == LoaderOptions::NORMALS_ANGLE ? faceCount * 3 : 0, _scratch.getResource());
+
+    // Calculate face normals
+    jobs.parallelFor(faceCount, LOOP_GRAIN, [&](size_t first, size_t last) {
+        for (size_t f = first; f < last; f++) {
+            GLfloat v0[3], v1[3], v2[3];
+            getPosition(_raw.vIndices[f * 3], v0);
+            getPosition(_raw.vIndices[f * 3 + 1], v1);
+            getPosition(_raw.vIndices[f * 3 + 2], v2);
+
+            // Calculate edge vectors
+            GLfloat e1x = v1[0] - v0[0];
+            GLfloat e1y = v1[1] - v0[1];
+            GLfloat e1z = v1[2] - v0[2];
+
+            GLfloat e2x = v2[0] - v0[0];
+            GLfloat e2y = v2[1] - v0[1];
+            GLfloat e2z = v2[2] - v0[2];
+
+            // Cross product: normal = e1 × e2, its length is twice the area
+            GLfloat nx = e1y * e2z - e1z * e2y;
+            GLfloat ny = e1z * e2x - e1x * e2z;
+            GLfloat nz = e1x * e2y - e1y * e2x;
+
+            // Normalize unless area weighted
+            GLfloat len = sqrt(nx*nx + ny*ny + nz*nz);
+            if (weighting != LoaderOptions::NORMALS_AREA && len > 0.0001f) {
+                nx /= len;
+                ny /= len;
+                nz /= len;
+            }
+
+            faceNormals[f * 3] = nx;
+            faceNormals[f * 3 + 1] = ny;
+            faceNormals[f * 3 + 2] = nz;
+
+            if (!cornerAngles.empty()) {
+                const GLfloat *corner[3] = {v0, v1, v2};
+                for (int k = 0; k < 3; k++) {
+                    cornerAngles[f * 3 + k] = getCornerAngle(corner[k], corner[(k + 1) % 3], corner[(k + 2) % 3]);
+                }
+            }
         }
-
-        // Accumulate normal at each vertex
-        _raw.normals[idx0 * 3]     += nx;
-        _raw.normals[idx0 * 3 + 1] += ny;
-        _raw.normals[idx0 * 3 + 2] += nz;
-
-        _raw.normals[idx1 * 3]     += nx;
-        _raw.normals[idx1 * 3 + 1] += ny;
-        _raw.normals[idx1 * 3 + 2] += nz;
-
-        _raw.normals[idx2 * 3]     += nx;
-        _raw.normals[idx2 * 3 + 1] += ny;
-        _raw.normals[idx2 * 3 + 2] += nz;
-
-        // Set normal indices (same as vertex indices)
-        _raw.vnIndices[i]     = idx0;
-        _raw.vnIndices[i + 1] = idx1;
-        _raw.vnIndices[i + 2] = idx2;
-    }
-
-    // Normalize all accumulated normals
-    for (size_t i = 0; i < _raw.normals.size(); i += 3) {
-        GLfloat nx = _raw.normals[i];
-        GLfloat ny = _raw.normals[i + 1];
-        GLfloat nz = _raw.normals[i + 2];
-
-        GLfloat len = sqrt(nx*nx + ny*ny + nz*nz);
-        if (len > 0.0001f) {
-            _raw.normals[i]     /= len;
-            _raw.normals[i + 1] /= len;
-            _raw.normals[i + 2] /= len;
+    });
+
+    // Gather the face normals at each vertex and normalize
+    MeshTopology topology(_raw.vIndices, vertexCount, _scratch.getResource());
+    jobs.parallelFor(vertexCount, LOOP_GRAIN, [&](size_t first, size_t last) {
+        for (size_t v = first; v < last; v++) {
+            GLfloat nx = 0.0f;
+            GLfloat ny = 0.0f;
+            GLfloat nz = 0.0f;
+
+            for (GLuint f : topology.getFaces(v)) {
+                const GLfloat *faceNormal = &faceNormals[f * 3];
+                if (cornerAngles.empty()) {
+                    nx += faceNormal[0];
+                    ny += faceNormal[1];
+                    nz += faceNormal[2];
+                    continue;
+                }
+
+                const GLuint *face = &_raw.vIndices[f * 3];
+                int k = (face[0] == v) ? 0 : (face[1] == v) ? 1 : 2;
+                GLfloat angle = cornerAngles[f * 3 + k];
+                nx += faceNormal[0] * angle;
+                ny += faceNormal[1] * angle;
+                nz += faceNormal[2] * angle;
+            }
+
+            GLfloat len = sqrt(nx*nx + ny*ny + nz*nz);
+            if (len > 0.0001f) {
+                nx /= len;
+                ny /= len;
+                nz /= len;
+            }
+            _raw.normals[v * 3] = nx;
+            _raw.normals[v * 3 + 1] = ny;
+            _raw.normals[v * 3 + 2] = nz;
         }
-	}
+    });
 }
 
 void RenderModelLoader::centerVertices() {
@@ -271,12 +625,11 @@ void RenderModelLoader::centerVertices() {
     GLfloat centerZ = (_bbox.minZ + _bbox.maxZ) / 2.0f;
 
     // Shift all vertices to center the model at origin
-    for (size_t i = 0; i < _raw.vertices.size(); i += 4) {
-        _raw.vertices[i]     -= centerX;  // x
-        _raw.vertices[i + 1] -= centerY;  // y
-        _raw.vertices[i + 2] -= centerZ;  // z
-        // _raw.vertices[i + 3] is the w component (1.0), leave it
-    }
+    getJobs().parallelFor(_raw.positions.size(), LOOP_GRAIN, [&](size_t first, size_t last) {
+        PositionKernels::subtract(&_raw.positions.x[first], last - first, centerX);
+        PositionKernels::subtract(&_raw.positions.y[first], last - first, centerY);
+        PositionKernels::subtract(&_raw.positions.z[first], last - first, centerZ);
+    });
 
     // Update bounding box to reflect new centered coordinates
     _bbox.minX -= centerX;
@@ -285,86 +638,473 @@ void RenderModelLoader::centerVertices() {
     _bbox.maxY -= centerY;
     _bbox.minZ -= centerZ;
     _bbox.maxZ -= centerZ;
-
-    // std::cout << "Model centered: offset(" << centerX << ", " << centerY << ", " << centerZ << ")\n";
 }
 
+/**
+* @brief Builds an indexed mesh with one vertex per distinct (v, vt, vn).
+*
+* Every attribute of an output vertex is derived from its three OBJ
+* indices, so corners sharing them are welded into a single vertex.
+* Vertices are emitted in first-use order. Face colors are not stored
+* per vertex, the fragment shader derives them from gl_PrimitiveID.
+*
+* With `optimizeVertexCache` the triangles of every submesh are then
+* reordered for the post-transform cache and the vertices for fetch
+* locality. Coarser levels of detail are appended to the index buffer,
+* see buildLods(), and every level is split into culling clusters, see
+* buildClusters().
+*
+* Corners are welded first, so the float buffer is allocated once with
+* the final vertex count. Attributes are written at their
+* VERTEX_SEMANTICS offsets and packed into the VertexLayout of the
+* requested format, normalized positions relative to the centered
+* bounding box. With `streamingUpload` packing is left to the consumer,
+* see MeshBuffers::packVertices().
+*/
 void RenderModelLoader::buildMesh() {
-    _mesh.vertices.clear();
+    _vertices.clear();
     _mesh.indices.clear();
+    buildSubmeshes();
 
-    calculateBoundingBox();
-	centerVertices();
+    const size_t corners = _raw.vIndices.size();
+    VertexWelder welder(corners);
+    _mesh.indices.reserve(corners);
 
-    // Seed random number generator
-    srand(static_cast<unsigned>(time(nullptr)));
+    // first pass: weld corners, which fixes the vertex count
+    for (size_t i = 0; i < corners; i++) {
+        VertexKey key;
+        key.v = _raw.vIndices[i];
+        key.vt = (i < _raw.vtIndices.size()) ? _raw.vtIndices[i] : 0;
+        key.vn = (i < _raw.vnIndices.size()) ? _raw.vnIndices[i] : 0;
 
-    for (size_t i = 0; i < _raw.vIndices.size(); i += 3) {
-        // Generate random vibrant color for this face
-        GLfloat faceR = 0.3f + (static_cast<GLfloat>(rand()) / RAND_MAX) * 0.7f;
-        GLfloat faceG = 0.3f + (static_cast<GLfloat>(rand()) / RAND_MAX) * 0.7f;
-        GLfloat faceB = 0.3f + (static_cast<GLfloat>(rand()) / RAND_MAX) * 0.7f;
+        bool inserted;
+        _mesh.indices.push_back(welder.weld(key, inserted));
+    }
 
-        // Process each vertex of the triangle
-        for (int v = 0; v < 3; v++) {
-            GLuint vIdx = _raw.vIndices[i + v];
-            GLuint vtIdx = (i + v < _raw.vtIndices.size()) ? _raw.vtIndices[i + v] : 0;
-            GLuint vnIdx = (i + v < _raw.vnIndices.size()) ? _raw.vnIndices[i + v] : 0;
+    // second pass: fill the exactly sized float buffer, one vertex per key, in parallel
+    const vector<VertexKey> &keys = welder.getUniqueKeys();
+    const size_t vertexCount = keys.size();
+    _vertices.resize(vertexCount * Mesh::FLOATS_PER_VERTEX);
 
-            // Position (x, y, z)
-            _posX = _raw.vertices[vIdx * 4];
-            _posY = _raw.vertices[vIdx * 4 + 1];
-            _posZ = _raw.vertices[vIdx * 4 + 2];
+    getJobs().parallelFor(vertexCount, LOOP_GRAIN, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            const VertexKey &key = keys[i];
+            GLfloat *vertex = &_vertices[i * Mesh::FLOATS_PER_VERTEX];
 
-            _mesh.vertices.push_back(_posX);
-            _mesh.vertices.push_back(_posY);
-            _mesh.vertices.push_back(_posZ);
+            // Position (x, y, z)
+            getPosition(key.v, &vertex[POSITION_OFFSET]);
 
             // UV coordinates
-            calculateUVCoordinates(vtIdx, vnIdx);
+            calculateUVCoordinates(key.vt, key.vn, vertex);
 
             // Vertex color (per-vertex gradient based on normals)
-            calculateVertexColor(vnIdx);
+            calculateVertexColor(key.vn, vertex);
+        }
+    });
+
+    VertexCacheStats welded;
+    if (_options.printStats) {
+        welded = MeshAnalysis::analyzeVertexCache(_mesh.indices, vertexCount);
+    }
+
+    if (_options.optimizeVertexCache) {
+        optimizeSubmeshes(vertexCount);
+    }
+
+    _mesh.format = _options.vertexFormat;
+    if (_options.printStats) {
+        printMeshStats(welded);
+    }
+    buildLods(vertexCount);
+
+    // renumber after the LODs are appended, they index the same vertices
+    if (_options.optimizeVertexCache) {
+        MeshOptimizer::optimizeVertexFetch(_vertices, _mesh.indices, Mesh::FLOATS_PER_VERTEX);
+    }
+    buildClusters();
+    calculateSubmeshBounds();
+
+    if (_options.streamingUpload) {
+        _buffers.emplace(move(_vertices), move(_mesh), _bbox);
+        return;
+    }
+
+    const size_t packedVertices = _vertices.size() / Mesh::FLOATS_PER_VERTEX;
+    _mesh.vertices.resize(packedVertices * getVertexStride(_mesh.format));
+    VertexPacker::pack(_vertices.data(), packedVertices, _mesh.format,
+        PositionDecode::fromBounds(_bbox, _mesh.format), _mesh.vertices.data());
+    vector<GLfloat>().swap(_vertices);
+    _buffers.emplace(move(_mesh), _bbox);
+}
+
+/**
+* @brief Resolves the o/g/usemtl records into submeshes of the face
+* order, with their level 0 index ranges.
+*
+* A submesh is named after its group, or its object outside of groups,
+* and ends where the name or the material changes. Statements without
+* faces in between leave no submesh; a file without any gives a single
+* unnamed submesh over all faces.
+*/
+void RenderModelLoader::buildSubmeshes() {
+    _mesh.submeshes.clear();
+    _mesh.submeshLods.clear();
+    _mesh.names.assign(1, '\0');
+
+    unordered_map<string, GLuint> nameOffsets = {{string(), 0}};
+    auto addName = [&](const string &name) {
+        auto [it, inserted] = nameOffsets.try_emplace(name, static_cast<GLuint>(_mesh.names.size()));
+        if (inserted) {
+            _mesh.names.insert(_mesh.names.end(), name.c_str(), name.c_str() + name.size() + 1);
+        }
+        return it->second;
+    };
+
+    string object, group, material;
+    MeshSubmesh current;
+    size_t first = 0;  // first triangle of the current submesh
+
+    auto close = [&](size_t end) {
+        if (end == first) {
+            return;
+        }
+        MeshLod range = {static_cast<GLuint>(first * 3), static_cast<GLuint>((end - first) * 3), 0.0f};
+        MeshSubmesh *last = _mesh.submeshes.empty() ? nullptr : &_mesh.submeshes.back();
+        if (last && last->nameOffset == current.nameOffset && last->materialOffset == current.materialOffset) {
+            _mesh.submeshLods.back().indexCount += range.indexCount;
+        } else {
+            _mesh.submeshes.push_back(current);
+            _mesh.submeshLods.push_back(range);
+        }
+        first = end;
+    };
+
+    for (const OBJGroupRecord &record : _raw.groups) {
+        close(record.firstTriangle);
+        if (record.kind == OBJGroupRecord::OBJECT) {
+            object = record.value;
+            group.clear();
+        } else if (record.kind == OBJGroupRecord::GROUP) {
+            group = record.value;
+        } else {
+            material = record.value;
+        }
+        current.nameOffset = addName(group.empty() ? object : group);
+        current.materialOffset = addName(material);
+    }
+    close(_raw.vIndices.size() / 3);
+}
+
+/**
+* @brief Runs the vertex cache pass on the level 0 range of every submesh.
+*
+* A single submesh is the whole index buffer and keeps the mesh numbering.
+*/
+void RenderModelLoader::optimizeSubmeshes(size_t vertexCount) {
+    if (_mesh.submeshes.size() <= 1) {
+        MeshOptimizer::optimizeVertexCache(_mesh.indices, vertexCount);
+        return;
+    }
+
+    vector<GLuint> localOf(vertexCount, NO_VERTEX);
+    for (const MeshLod &range : _mesh.submeshLods) {
+        optimizeSubmesh(&_mesh.indices[range.firstIndex], range.indexCount, localOf);
+    }
+}
+
+/**
+* @brief Appends up to `lodLevels - 1` simplified copies of the mesh.
+*
+* Each level targets half the triangles of the previous one and is
+* simplified from it, submesh by submesh, so its error is the sum of the
+* level errors. The edges between submeshes are open borders to the
+* simplifier and stay in place. A submesh that cannot be reduced keeps
+* its previous triangles. The chain stops early when a level saves less
+* than LOD_MIN_REDUCTION or the error would exceed LOD_MAX_ERROR of the
+* largest model extent. All levels index the same vertices; level 0 is
+* the full mesh.
+*/
+void RenderModelLoader::buildLods(size_t vertexCount) {
+    const size_t submeshCount = _mesh.submeshes.size();
+    _mesh.lods.assign(1, MeshLod{0, static_cast<GLuint>(_mesh.indices.size()), 0.0f});
+
+    const GLfloat extent = max({_bbox.getRangeX(), _bbox.getRangeY(), _bbox.getRangeZ()});
+    const GLfloat maxError = extent * LOD_MAX_ERROR;
+    vector<vector<GLuint>> previous(submeshCount);
+    for (size_t s = 0; s < submeshCount; s++) {
+        auto first = _mesh.indices.begin() + _mesh.submeshLods[s].firstIndex;
+        previous[s].assign(first, first + _mesh.submeshLods[s].indexCount);
+    }
+    vector<GLfloat> errors(submeshCount, 0.0f);
+    vector<GLuint> localOf(submeshCount > 1 ? vertexCount : 0, NO_VERTEX);
+    GLfloat error = 0.0f;
+
+    for (unsigned level = 1; level < _options.lodLevels && error < maxError; level++) {
+        vector<vector<GLuint>> current(submeshCount);
+        vector<GLfloat> currentErrors = errors;
+        vector<bool> simplified(submeshCount, false);
+        size_t previousCount = 0;
+        size_t count = 0;
+
+        for (size_t s = 0; s < submeshCount; s++) {
+            GLfloat levelError;
+            size_t target = previous[s].size() / 2 / 3 * 3;
+            vector<GLuint> lod = (submeshCount == 1)
+                ? MeshSimplifier::simplify(_vertices, Mesh::FLOATS_PER_VERTEX, POSITION_OFFSET,
+                    previous[s], target, maxError - errors[s], levelError)
+                : simplifySubmesh(_vertices, previous[s], target, maxError - errors[s], levelError, localOf);
+
+            if (!lod.empty() && lod.size() < previous[s].size()) {
+                current[s] = move(lod);
+                currentErrors[s] += levelError;
+                simplified[s] = true;
+            } else {
+                current[s] = previous[s];
+            }
+            previousCount += previous[s].size();
+            count += current[s].size();
+        }
+        if (count > previousCount * (1.0f - LOD_MIN_REDUCTION)) {
+            break;
+        }
+
+        error = *max_element(currentErrors.begin(), currentErrors.end());
+        _mesh.lods.push_back({static_cast<GLuint>(_mesh.indices.size()), static_cast<GLuint>(count), error});
+        for (size_t s = 0; s < submeshCount; s++) {
+            if (_options.optimizeVertexCache && simplified[s]) {
+                if (submeshCount == 1) {
+                    MeshOptimizer::optimizeVertexCache(current[s], vertexCount);
+                } else {
+                    optimizeSubmesh(current[s].data(), current[s].size(), localOf);
+                }
+            }
+            _mesh.submeshLods.push_back({static_cast<GLuint>(_mesh.indices.size()),
+                static_cast<GLuint>(current[s].size()), currentErrors[s]});
+            _mesh.indices.insert(_mesh.indices.end(), current[s].begin(), current[s].end());
+        }
+        previous = move(current);
+        errors = move(currentErrors);
+    }
+
+    if (_options.printStats && _mesh.lods.size() > 1) {
+        cout << "  LODs:";
+        for (const MeshLod &lod : _mesh.lods) {
+            cout << " " << lod.indexCount / 3 << " (" << lod.error << ")";
+        }
+        cout << " triangles (error)\n";
+    }
+}
 
-            // Face color (random vibrant, same for all 3 vertices)
-            _mesh.vertices.push_back(faceR);
-            _mesh.vertices.push_back(faceG);
-            _mesh.vertices.push_back(faceB);
+/**
+* @brief Splits every submesh of every level of detail into MeshClusters
+* for culling.
+*
+* Back-face cones are only kept for closed meshes; through the holes of
+* an open one the back of the surface can be seen.
+*/
+void RenderModelLoader::buildClusters() {
+    _mesh.clusters.clear();
+    const MeshLod &full = _mesh.lods.front();
+    bool closed = MeshClusterizer::isClosed(_vertices, Mesh::FLOATS_PER_VERTEX, POSITION_OFFSET,
+        _mesh.indices, full.firstIndex, full.indexCount);
+
+    // shared by every range, so many small submeshes do not cost ranges x vertices
+    vector<GLuint> vertexStamps(_vertices.size() / Mesh::FLOATS_PER_VERTEX, 0);
+    GLuint lastStamp = 0;
+    for (const MeshLod &range : _mesh.submeshLods) {
+        MeshClusterizer::buildClusters(_vertices, Mesh::FLOATS_PER_VERTEX, POSITION_OFFSET,
+            _mesh.indices, range.firstIndex, range.indexCount, closed, vertexStamps, lastStamp, _mesh.clusters);
+    }
 
-            _mesh.indices.push_back(static_cast<GLuint>(_mesh.indices.size()));
+    if (_options.printStats) {
+        cout << "  clusters: " << _mesh.clusters.size() << " over " << _mesh.lods.size() << " LODs, "
+            << (closed ? "closed, back-face cones on" : "open, back-face cones off") << "\n";
+        if (_mesh.submeshes.size() > 1) {
+            cout << "  submeshes: " << _mesh.submeshes.size() << "\n";
         }
     }
 }
 
+/**
+* @brief Bounding sphere of every submesh around the center of its box,
+* from its level 0 triangles.
+*/
+void RenderModelLoader::calculateSubmeshBounds() {
+    for (size_t s = 0; s < _mesh.submeshes.size(); s++) {
+        MeshSubmesh &submesh = _mesh.submeshes[s];
+        const MeshLod &range = _mesh.submeshLods[s];
+        const GLuint *indices = &_mesh.indices[range.firstIndex];
+
+        BoundingBox box;
+        for (GLuint i = 0; i < range.indexCount; i++) {
+            const GLfloat *p = &_vertices[indices[i] * Mesh::FLOATS_PER_VERTEX + POSITION_OFFSET];
+            box.minX = min(box.minX, p[0]);
+            box.maxX = max(box.maxX, p[0]);
+            box.minY = min(box.minY, p[1]);
+            box.maxY = max(box.maxY, p[1]);
+            box.minZ = min(box.minZ, p[2]);
+            box.maxZ = max(box.maxZ, p[2]);
+        }
+        submesh.center[0] = (box.minX + box.maxX) * 0.5f;
+        submesh.center[1] = (box.minY + box.maxY) * 0.5f;
+        submesh.center[2] = (box.minZ + box.maxZ) * 0.5f;
+
+        GLfloat radiusSquared = 0.0f;
+        for (GLuint i = 0; i < range.indexCount; i++) {
+            const GLfloat *p = &_vertices[indices[i] * Mesh::FLOATS_PER_VERTEX + POSITION_OFFSET];
+            GLfloat dx = p[0] - submesh.center[0];
+            GLfloat dy = p[1] - submesh.center[1];
+            GLfloat dz = p[2] - submesh.center[2];
+            radiusSquared = max(radiusSquared, dx * dx + dy * dy + dz * dz);
+        }
+        submesh.radius = sqrt(radiusSquared);
+    }
+}
+
+void RenderModelLoader::printMeshStats(const VertexCacheStats &welded) const {
+    const size_t stride = getVertexStride(_mesh.format);
+    const size_t unweldedFloatsPerVertex = 11;  // one vertex per corner, face color included
+
+    size_t vertexCount = _vertices.size() / Mesh::FLOATS_PER_VERTEX;
+    size_t vboBytes = vertexCount * stride;
+    size_t unweldedBytes = _mesh.indices.size() * unweldedFloatsPerVertex * sizeof(GLfloat);
+
+    cout << "Mesh: " << _mesh.indices.size() / 3 << " triangles, "
+        << vertexCount << " vertices for " << _mesh.indices.size() << " corners\n"
+        << "  VBO " << vboBytes / 1024 << " KiB, " << stride << " B/vertex (unwelded "
+        << unweldedBytes / 1024 << " KiB, -"
+        << (unweldedBytes ? 100 - vboBytes * 100 / unweldedBytes : 0) << "%)\n"
+        << "  vertex cache (FIFO 32): ACMR " << welded.acmr << ", ATVR " << welded.atvr
+        << ", hit rate " << welded.hitRate * 100.0 << "%\n";
+
+    if (_options.optimizeVertexCache) {
+        VertexCacheStats optimized = MeshAnalysis::analyzeVertexCache(_mesh.indices, vertexCount);
+        cout << "  optimized:              ACMR " << optimized.acmr << ", ATVR " << optimized.atvr
+            << ", hit rate " << optimized.hitRate * 100.0 << "%\n";
+    }
+}
+
 
 // getters
 
-const Mesh &RenderModelLoader::getMesh() const {
-	return _mesh;
+/**
+* @brief Buffers to upload, either from the built mesh or the mapped cache.
+*
+* The view stays valid until takeMesh(). Vertices are empty while
+* packing is deferred (`streamingUpload`).
+*/
+MeshView RenderModelLoader::getMeshView() const {
+	return _buffers ? _buffers->getView() : MeshView();
+}
+
+/**
+* @brief Moves the finished buffers out of the loader.
+*
+* Afterwards the loader holds no mesh data; getMeshView() is empty.
+* @throws RenderModelLoaderException if the mesh was already taken.
+*/
+MeshBuffers RenderModelLoader::takeMesh() {
+	if (!_buffers) {
+		throw RenderModelLoaderException(RenderModelLoaderException::UNKNOWN_ERROR);
+	}
+	MeshBuffers buffers = move(*_buffers);
+	_buffers.reset();
+	return buffers;
+}
+
+const BoundingBox &RenderModelLoader::getBounds() const {
+	return _bbox;
+}
+
+bool RenderModelLoader::isFromCache() const {
+	return _fromCache;
+}
+
+const LoaderTimings &RenderModelLoader::getTimings() const {
+	return _timings;
 }
 
 // private //
 
-array<string, 3> getTokenValues(string &token) {
-	array<string, 3> tokenValues = {"", "", ""};
+/**
+* @brief Appends the indices of one triangle of a face to the chunk.
+*
+* Each of the v/vt/vn index streams is only extended when all three
+* corners carry that component. Range checks are deferred, see OBJChunk.
+*/
+void RenderModelLoader::addFaceTriangle(const FaceVertex &a, const FaceVertex &b, const FaceVertex &c, OBJChunk &chunk) {
+	RawOBJData &raw = chunk.data;
+	const int64_t readSoFar[3] = {
+		static_cast<int64_t>(raw.positions.size()),
+		static_cast<int64_t>(raw.texCoords.size() / 2),
+		static_cast<int64_t>(raw.normals.size() / 3),
+	};
+	pmr::vector<GLuint> *target[3] = {&raw.vIndices, &raw.vtIndices, &raw.vnIndices};
+
+	for (int k = 0; k < 3; k++) {
+		if (!a.has[k] || !b.has[k] || !c.has[k]) {
+			continue;
+		}
 
-	size_t slash = token.find('/');
-	if (slash == string::npos) {
-		tokenValues[0] = token;
-		return tokenValues;
+		int64_t maxIdx = max({a.idx[k], b.idx[k], c.idx[k]});
+		chunk.maxExcess[k] = max(chunk.maxExcess[k], maxIdx - readSoFar[k]);
+
+		target[k]->push_back(a.idx[k]);
+		target[k]->push_back(b.idx[k]);
+		target[k]->push_back(c.idx[k]);
 	}
+}
 
-	size_t slash2 = token.find('/', slash + 1);
-	tokenValues[0] = token.substr(0, slash);
+/**
+* @brief Parses OBJ records from memory, one record per line.
+*
+* Lines are located with memchr() and decoded in place, so no per-line
+* strings or streams are allocated.
+*/
+void RenderModelLoader::parseLines(const char *data, const char *end, OBJChunk &chunk) {
+	const char *p = data;
 
-	if (slash2 == string::npos) {
-		tokenValues[1] = token.substr(slash + 1);
-	} else {
-		tokenValues[1] = token.substr(slash + 1, slash2 - slash - 1);
-		tokenValues[2] = token.substr(slash2 + 1);
+	while (p != end) {
+		const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+		if (!eol) {
+			eol = end;
+		}
+
+		parseRecord(p, eol, chunk);
+		p = (eol == end) ? end : eol + 1;
 	}
+}
 
-	return tokenValues;
+void RenderModelLoader::parseRecord(const char *line, const char *end, OBJChunk &chunk) {
+	RawOBJData &raw = chunk.data;
+	line = OBJScanner::skipBlanks(line, end);
+	const char *typeEnd = OBJScanner::findBlank(line, end);
+	string_view type(line, typeEnd - line);
+
+	GLfloat values[3];
+	if (type == "v") {
+		OBJScanner::scanFloats(typeEnd, end, values, 3);
+		raw.positions.append(values[0], values[1], values[2]);
+	} else if (type == "vt") {
+		OBJScanner::scanFloats(typeEnd, end, values, 2);
+		raw.texCoords.push_back(values[0]);
+		raw.texCoords.push_back(values[1]);
+	} else if (type == "vn") {
+		OBJScanner::scanFloats(typeEnd, end, values, 3);
+		raw.normals.push_back(values[0]);
+		raw.normals.push_back(values[1]);
+		raw.normals.push_back(values[2]);
+	} else if (type == "f") {
+		parseFaces(typeEnd, end, chunk);
+	} else if (type == "o" || type == "g" || type == "usemtl") {
+		OBJGroupRecord record;
+		record.kind = (type == "o") ? OBJGroupRecord::OBJECT
+			: (type == "g") ? OBJGroupRecord::GROUP : OBJGroupRecord::MATERIAL;
+		record.firstTriangle = raw.vIndices.size() / 3;
+		const char *value = OBJScanner::skipBlanks(typeEnd, end);
+		record.value.assign(value, OBJScanner::trimBlanks(value, end));
+		raw.groups.push_back(move(record));
+	}
 }
 
 /**
@@ -377,82 +1117,42 @@ array<string, 3> getTokenValues(string &token) {
 *  - v/vt/vn
 *
 * Polygons with more than three vertices are triangulated
-* using a triangle fan method.
+* using a triangle fan method. Only the first and the previous
+* corner are kept, every further corner closes one more triangle.
 *
-* @param line Input stream containing face tokens.
-* @throws RenderModelLoaderException on invalid format or index errors.
+* @param line Start of the face tokens, behind the "f" keyword.
+* @param end End of the record.
+* @param chunk Receives the triangle indices.
+* @throws RenderModelLoaderException on invalid format or index overflow.
 */
-void RenderModelLoader::parseFaces(istringstream &line) {
-	vector<array<string, 3>> tokens;
-	string token;
+void RenderModelLoader::parseFaces(const char *line, const char *end, OBJChunk &chunk) {
+	FaceVertex first, prev;
+	int count = 0;
+
+	for (const char *p = OBJScanner::skipBlanks(line, end); p != end; p = OBJScanner::skipBlanks(p, end)) {
+		const char *tokenEnd = OBJScanner::findBlank(p, end);
+		FaceVertex current;
+
+		switch (OBJScanner::scanFaceVertex(p, tokenEnd, current)) {
+			case OBJScanner::SCAN_INVALID:
+				throw RenderModelLoaderException(RenderModelLoaderException::INVALID_FACE_FORMAT);
+			case OBJScanner::SCAN_OUT_OF_RANGE:
+				throw RenderModelLoaderException(RenderModelLoaderException::INDEX_OUT_OF_RANGE);
+			case OBJScanner::SCAN_OK:
+				break;
+		}
 
-	while (line >> token) {
-		tokens.push_back(getTokenValues(token));
+		if (count == 0) {
+			first = current;
+		} else if (count >= 2) {
+			addFaceTriangle(first, prev, current, chunk);
+		}
+		prev = current;
+		count++;
+		p = tokenEnd;
 	}
 
-	int tokensSize = tokens.size();
-	if (tokensSize < 3) {
+	if (count < 3) {
 		throw RenderModelLoaderException(RenderModelLoaderException::INVALID_FACE_FORMAT);
 	}
-
-	size_t maxVertexIndex = (_raw.vertices.size() / 4);
-	size_t maxTextureIndex = (_raw.texCoords.size() / 2);
-	size_t maxNormalIndex = (_raw.normals.size() / 3);
-
-	// how many triangles: tokensSize - 2
-	for (int i = 1; i + 1 != tokensSize; i++) {
-		try {
-			// Vertex indices
-			if ((!tokens[0][0].empty()) && (!tokens[i][0].empty()) && (!tokens[i + 1][0].empty())) {
-				GLuint idx0 = stoul(tokens[0][0]) - 1;
-				GLuint idx1 = stoul(tokens[i][0]) - 1;
-				GLuint idx2 = stoul(tokens[i + 1][0]) - 1;
-
-				// Validate indices
-				if (idx0 >= maxVertexIndex || idx1 >= maxVertexIndex || idx2 >= maxVertexIndex) {
-					throw RenderModelLoaderException(RenderModelLoaderException::INDEX_OUT_OF_RANGE);
-				}
-
-				_raw.vIndices.push_back(idx0);
-				_raw.vIndices.push_back(idx1);
-				_raw.vIndices.push_back(idx2);
-			}
-
-			// Texture coordinate indices
-			if ((!tokens[0][1].empty()) && (!tokens[i][1].empty()) && (!tokens[i + 1][1].empty())) {
-				GLuint idx0 = stoul(tokens[0][1]) - 1;
-				GLuint idx1 = stoul(tokens[i][1]) - 1;
-				GLuint idx2 = stoul(tokens[i + 1][1]) - 1;
-
-				// Validate indices
-				if (idx0 >= maxTextureIndex || idx1 >= maxTextureIndex || idx2 >= maxTextureIndex) {
-					throw RenderModelLoaderException(RenderModelLoaderException::INDEX_OUT_OF_RANGE);
-				}
-
-				_raw.vtIndices.push_back(idx0);
-				_raw.vtIndices.push_back(idx1);
-				_raw.vtIndices.push_back(idx2);
-			}
-
-			// Normal indices
-			if ((!tokens[0][2].empty()) && (!tokens[i][2].empty()) && (!tokens[i + 1][2].empty())) {
-				GLuint idx0 = stoul(tokens[0][2]) - 1;
-				GLuint idx1 = stoul(tokens[i][2]) - 1;
-				GLuint idx2 = stoul(tokens[i + 1][2]) - 1;
-
-				// Validate indices
-				if (idx0 >= maxNormalIndex || idx1 >= maxNormalIndex || idx2 >= maxNormalIndex) {
-					throw RenderModelLoaderException(RenderModelLoaderException::INDEX_OUT_OF_RANGE);
-				}
-
-				_raw.vnIndices.push_back(idx0);
-				_raw.vnIndices.push_back(idx1);
-				_raw.vnIndices.push_back(idx2);
-			}
-    	} catch (const invalid_argument&) {
-    	    throw RenderModelLoaderException(RenderModelLoaderException::INVALID_FACE_FORMAT);
-    	} catch (const out_of_range&) {
-    	    throw RenderModelLoaderException(RenderModelLoaderException::INDEX_OUT_OF_RANGE);
-    	}
-	}
 }
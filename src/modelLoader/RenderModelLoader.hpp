@@ -6,15 +6,21 @@
 * This module parses geometry data from an OBJ file and prepares
 * vertex and index buffers suitable for OpenGL rendering.
 *
+* By default the file is memory-mapped and records are decoded in
+* place; a line-by-line stream parser is kept as a fallback.
+*
 * Supported OBJ elements:
 *  - v   (vertex positions)
 *  - vt  (texture coordinates)
 *  - vn  (normal vectors)
 *  - f   (faces, triangulated using triangle fan)
+*  - o, g, usemtl (split the faces into submeshes)
+*
+* `usemtl` names are kept per submesh and resolved by the renderer
+* through MaterialLibrary, which reads the `mtllib` files (.mtl) and
+* their textures; this loader skips `mtllib` itself.
 *
 * Unsupported / ignored:
-*  - Materials (.mtl)
-*  - Multiple objects / groups
 *  - Negative indices
 */
 
@@ -23,8 +29,18 @@
 #include <vector>
 #include <string>
 #include <exception>
+#include <cstdint>
+#include <optional>
+#include <memory_resource>
 #include <glad/gl.h>
-#include <sstream>
+#include "OBJScanner.hpp"
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshBuffers.hpp"
+#include "MeshAnalysis.hpp"
+#include "PositionArrays.hpp"
+#include "ScratchPool.hpp"
+#include "../jobs/JobSystem.hpp"
 
 /**
 * @class RenderModelLoaderException
@@ -51,42 +67,146 @@ private:
 };
 
 
-struct BoundingBox {
-	GLfloat minX = 1e10f, maxX = -1e10f;
-	GLfloat minY = 1e10f, maxY = -1e10f;
-	GLfloat minZ = 1e10f, maxZ = -1e10f;
-
-	GLfloat getRangeX() const {
-		GLfloat r = maxX - minX;
-		return (r < 0.0001f) ? 1.0f : r;
-	}
-
-	GLfloat getRangeY() const {
-		GLfloat r = maxY - minY;
-		return (r < 0.0001f) ? 1.0f : r;
-	}
+/**
+* @struct OBJGroupRecord
+* @brief An `o`, `g` or `usemtl` statement and the triangle it precedes.
+*
+* A chunk does not know the object, group and material in effect at its
+* start, so the statements are only resolved once the chunks are merged,
+* see buildSubmeshes().
+*/
+struct OBJGroupRecord {
+    enum Kind {
+        OBJECT,
+        GROUP,
+        MATERIAL,
+    };
 
-	GLfloat getRangeZ() const {
-		GLfloat r = maxZ - minZ;
-		return (r < 0.0001f) ? 1.0f : r;
-	}
+    Kind kind = OBJECT;
+    size_t firstTriangle = 0;  // triangles read before it, within its chunk until merged
+    std::string value;
 };
 
+/**
+* @struct RawOBJData
+* @brief The OBJ records of a file (or chunk) before welding.
+*
+* Only needed while the model loads, so the arrays are allocated from
+* the loader's ScratchPool.
+*/
 struct RawOBJData {
-    std::vector<GLfloat> vertices;   // x,y,z,w per vertex
-    std::vector<GLfloat> texCoords;  // u,v per texcoord
-    std::vector<GLfloat> normals;    // x,y,z per normal
-    std::vector<GLuint> vIndices;    // vertex indices from faces
-    std::vector<GLuint> vtIndices;   // texcoord indices from faces
-    std::vector<GLuint> vnIndices;   // normal indices from faces
+    PositionArrays positions;             // x, y, z per vertex
+    std::pmr::vector<GLfloat> texCoords;  // u,v per texcoord
+    std::pmr::vector<GLfloat> normals;    // x,y,z per normal
+    std::pmr::vector<GLuint> vIndices;    // vertex indices from faces
+    std::pmr::vector<GLuint> vtIndices;   // texcoord indices from faces
+    std::pmr::vector<GLuint> vnIndices;   // normal indices from faces
+    std::pmr::vector<OBJGroupRecord> groups;  // o, g and usemtl in file order
+
+    explicit RawOBJData(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+        positions(resource), texCoords(resource), normals(resource),
+        vIndices(resource), vtIndices(resource), vnIndices(resource), groups(resource)
+    {}
 
     bool hasTexCoords() const { return !texCoords.empty() && !vtIndices.empty(); }
     bool hasNormals() const { return !normals.empty() && !vnIndices.empty(); }
 };
 
-struct Mesh {
-    std::vector<GLfloat> vertices;   // interleaved [x,y,z,u,v,r_v,g_v,b_v,r_f,g_f,b_f]
-    std::vector<GLuint> indices;     // deduplicated indices
+/**
+* @struct OBJChunk
+* @brief Parse result of one newline-aligned slice of an OBJ file.
+*
+* Face indices are absolute, but a chunk does not know how many
+* vertices, texcoords and normals earlier chunks define. Instead of
+* validating on the spot it keeps, per index stream, the largest
+* (index - elements read so far in this chunk). The index is valid iff
+* that value is below the number of elements defined by all earlier
+* chunks, which is checked once the chunks are merged.
+*/
+struct OBJChunk {
+    RawOBJData data;   // allocated from the loader's ScratchPool
+    int64_t maxExcess[3] = {INT64_MIN, INT64_MIN, INT64_MIN};  // v, vt, vn
+};
+
+/**
+* @struct LoaderOptions
+* @brief Switches that select how a model file is turned into a Mesh.
+*
+* MAPPED parses records straight from a read-only mapping of the file,
+* STREAM reads it line by line through std::ifstream. Both decode the
+* records with OBJScanner. PARALLEL maps the file as well and splits it
+* into newline-aligned chunks, `parseThreads` of them (0 = one per
+* thread of the job system); files below `minChunkSize` per thread
+* use fewer threads. The mapped modes fall back to STREAM for files that
+* cannot be mapped (pipes, special files).
+*
+* Parsing and the per-vertex and per-face loops run as parallelFor()
+* ranges on `jobs` (nullptr = JobSystem::getShared()). Their results do
+* not depend on the number of threads.
+*
+* Models without normals get them from their faces, weighted as
+* `normalWeighting` says (equally, by area or by corner angle).
+*
+* With `useMeshCache` the finished mesh is written to a MeshCache next
+* to the model and later loads map that file instead of parsing.
+*
+* `optimizeVertexCache` runs the MeshOptimizer passes on the index and
+* vertex buffers. `vertexFormat` selects the encoding of the vertex
+* buffer, see VertexFormat.
+*
+* `lodLevels` is the number of levels of detail to build, the full mesh
+* included (1 disables simplification), see MeshSimplifier.
+*
+* `printStats` reports the cache, the mesh statistics (vertex cache,
+* LODs, clusters) and the scratch memory of every load on cout.
+*
+* With `streamingUpload` the vertices are not packed up front; the
+* renderer and the cache writer pack them chunk by chunk straight into
+* their destination, so no packed CPU copy of the mesh is kept. The
+* float build buffer (32 bytes per vertex) is kept instead, until the
+* upload finishes. That only saves memory for VERTEX_FLOAT, whose packed
+* copy is as large; for VERTEX_QUANTIZED it doubles what each mesh holds
+* across the hand-off and the multi-frame upload, and leaves the packing
+* to the render thread, so it is off by default.
+*/
+struct LoaderOptions {
+	enum ParseMode {
+		STREAM,
+		MAPPED,
+		PARALLEL,
+	};
+
+	enum NormalWeighting {
+		NORMALS_UNIFORM,
+		NORMALS_AREA,
+		NORMALS_ANGLE,
+	};
+
+	ParseMode parseMode = PARALLEL;
+	unsigned parseThreads = 0;
+	size_t minChunkSize = 4 << 20;
+	JobSystem *jobs = nullptr;
+	NormalWeighting normalWeighting = NORMALS_UNIFORM;
+	bool useMeshCache = true;
+	bool optimizeVertexCache = true;
+	VertexFormat vertexFormat = VERTEX_QUANTIZED;
+	unsigned lodLevels = 4;
+	bool streamingUpload = false;
+	bool printStats = false;
+};
+
+/**
+* @struct LoaderTimings
+* @brief Wall time of the load stages of the last parse, in milliseconds.
+*
+* `buildMs` covers welding, cache optimization, LODs and clusters. All
+* stages stay 0 for meshes loaded from the cache.
+*/
+struct LoaderTimings {
+	double parseMs = 0.0;
+	double normalsMs = 0.0;
+	double boundsMs = 0.0;   // bounding box and centering
+	double buildMs = 0.0;
 };
 
 /**
@@ -99,36 +219,64 @@ struct Mesh {
 * Faces with more than three vertices are automatically
 * triangulated using a triangle fan approach.
 *
-* Vertex data is stored separately from index buffers,
-* enabling indexed rendering (e.g. via OpenGL EBOs).
+* Face corners with identical v/vt/vn indices are welded into one
+* vertex, so the index buffer (EBO) reuses shared vertices.
+*
+* Faces stay grouped in file order and are split into MeshSubmeshes
+* wherever the object, group or material changes. Every later pass keeps
+* the submeshes apart, so each one is a single index range per level.
 */
 class RenderModelLoader {
 public:
-    explicit RenderModelLoader(const std::string &path);
+    explicit RenderModelLoader(const std::string &path, const LoaderOptions &options = LoaderOptions());
 
-    const Mesh &getMesh() const;
+    MeshView getMeshView() const;
+    MeshBuffers takeMesh();
+    const BoundingBox &getBounds() const;
+    bool isFromCache() const;
+    const LoaderTimings &getTimings() const;
 
 private:
     Mesh _mesh;
+    std::vector<GLfloat> _vertices;  // float build buffer, see Mesh::FLOATS_PER_VERTEX
+    std::optional<MeshBuffers> _buffers;
+    ScratchPool _scratch;            // parse data and stage temporaries, see releaseScratch()
     RawOBJData _raw;
     BoundingBox _bbox;
     std::string _path;
+    LoaderOptions _options;
+    MeshCache _cache;
+    bool _fromCache = false;
+    LoaderTimings _timings;
 
-    GLfloat _posX;
-    GLfloat _posY;
-    GLfloat _posZ;
-    GLfloat _nx;
-    GLfloat _ny;
-    GLfloat _nz;
-
+    std::pmr::vector<OBJChunk> makeChunks(size_t count);
     void parseOBJFile();
-    void parseFaces(std::istringstream &line);
+    void parseStreamOBJFile(OBJChunk &chunk);
+    void parseMappedOBJFile(const char *data, size_t size);
+    size_t getChunkCount(size_t size) const;
+    void mergeChunks(std::pmr::vector<OBJChunk> &chunks);
+    static void parseLines(const char *data, const char *end, OBJChunk &chunk);
+    static void parseRecord(const char *line, const char *end, OBJChunk &chunk);
+    static void parseFaces(const char *line, const char *end, OBJChunk &chunk);
+    static void addFaceTriangle(const FaceVertex &a, const FaceVertex &b, const FaceVertex &c, OBJChunk &chunk);
     void buildMesh();
+    void buildSubmeshes();
+    void optimizeSubmeshes(size_t vertexCount);
+    void buildLods(size_t vertexCount);
+    void buildClusters();
+    void calculateSubmeshBounds();
+    void printMeshStats(const VertexCacheStats &welded) const;
+    JobSystem &getJobs() const;
+    static uint32_t getCacheFlags(const LoaderOptions &options);
+    bool loadMeshCache();
+    void storeMeshCache();
+    void releaseScratch();
     void calculateNormals();
     void calculateBoundingBox();
-    void calculateUVCoordinates(GLuint vtIdx, GLuint vnIdx);
-    void calculateVertexColor(GLuint vnIdx);
-    void calculateCubicUV();
+    void getPosition(GLuint vIdx, GLfloat *out) const;
+    void calculateUVCoordinates(GLuint vtIdx, GLuint vnIdx, GLfloat *vertex) const;
+    void calculateVertexColor(GLuint vnIdx, GLfloat *vertex) const;
+    void calculateCubicUV(const GLfloat *normal, GLfloat *vertex) const;
     void centerVertices();
 
     RenderModelLoader();
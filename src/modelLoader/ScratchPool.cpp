@@ -0,0 +1,61 @@
+#include "ScratchPool.hpp"
+#include <memory_resource>
+#include <mutex>
+
+using namespace std;
+
+ScratchPool::ScratchPool() :
+	_heap(pmr::new_delete_resource(), nullptr), _pool(&_heap), _requests(&_pool, &_mutex)
+{}
+
+pmr::memory_resource *ScratchPool::getResource() {
+	return &_requests;
+}
+
+void ScratchPool::release() {
+	lock_guard<mutex> lock(_mutex);
+	_pool.release();
+}
+
+// getters //
+
+size_t ScratchPool::getAllocationCount() const {
+	return _requests.allocations;
+}
+
+size_t ScratchPool::getHeapBlockCount() const {
+	return _heap.allocations;
+}
+
+size_t ScratchPool::getAllocatedBytes() const {
+	return _requests.bytes;
+}
+
+// private //
+
+ScratchPool::CountingResource::CountingResource(pmr::memory_resource *upstream, mutex *lock) :
+	_upstream(upstream), _lock(lock)
+{}
+
+void *ScratchPool::CountingResource::do_allocate(size_t size, size_t alignment) {
+	unique_lock<mutex> lock;
+	if (_lock) {
+		lock = unique_lock<mutex>(*_lock);
+	}
+	void *pointer = _upstream->allocate(size, alignment);
+	allocations++;
+	bytes += size;
+	return pointer;
+}
+
+void ScratchPool::CountingResource::do_deallocate(void *pointer, size_t size, size_t alignment) {
+	unique_lock<mutex> lock;
+	if (_lock) {
+		lock = unique_lock<mutex>(*_lock);
+	}
+	_upstream->deallocate(pointer, size, alignment);
+}
+
+bool ScratchPool::CountingResource::do_is_equal(const pmr::memory_resource &other) const noexcept {
+	return this == &other;
+}
@@ -0,0 +1,68 @@
+/**
+* @file ScratchPool.hpp
+* @brief Memory for data that only lives while a model loads.
+*
+* Parse arrays, per-stage temporaries and adjacency tables come from one
+* std::pmr pool and are dropped together by release() when the load is
+* done. Small blocks are recycled inside the pool; large ones (the
+* geometrically growing parse arrays) go back to the heap as soon as a
+* container lets go of them, so peak memory stays what it was without
+* the pool. Both sides are counted, so the loader can report how many
+* requests were served and how many heap blocks that took.
+*/
+
+#pragma once
+
+#include <memory_resource>
+#include <mutex>
+#include <cstddef>
+
+/**
+* @class ScratchPool
+* @brief Counting, thread-safe front of a std::pmr pool resource.
+*
+* Allocations are serialized by a mutex; the loader allocates a few
+* hundred times per model (containers grow geometrically), so parallel
+* stages do not contend on it.
+*/
+class ScratchPool {
+public:
+	ScratchPool();
+
+	ScratchPool(const ScratchPool &other) = delete;
+	ScratchPool &operator=(const ScratchPool &other) = delete;
+
+	std::pmr::memory_resource *getResource();
+
+	// Every pointer into the pool must be gone before this is called.
+	void release();
+
+	size_t getAllocationCount() const;
+	size_t getHeapBlockCount() const;
+	size_t getAllocatedBytes() const;
+
+private:
+	/**
+	* @brief Forwards to `upstream` and counts the calls and bytes.
+	*/
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		CountingResource(std::pmr::memory_resource *upstream, std::mutex *lock);
+
+		size_t allocations = 0;
+		size_t bytes = 0;
+
+	private:
+		std::pmr::memory_resource *_upstream;
+		std::mutex *_lock;  // nullptr when the caller already holds one
+
+		void *do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void *pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+	};
+
+	std::mutex _mutex;
+	CountingResource _heap;                        // blocks the pool takes from the heap
+	std::pmr::unsynchronized_pool_resource _pool;
+	CountingResource _requests;                    // what the loader asks for, locked
+};
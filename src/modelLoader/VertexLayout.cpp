@@ -0,0 +1,51 @@
+#include "VertexLayout.hpp"
+#include <glad/gl.h>
+#include <cstring>
+#include <cstdint>
+
+/**
+* @brief Converts to IEEE 754 binary16, rounding to nearest even.
+*
+* Values beyond the half range become infinity, tiny values denormals.
+*/
+GLushort floatToHalf(GLfloat value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	uint32_t exponent = (bits >> 23) & 0xFFu;
+	uint32_t mantissa = bits & 0x7FFFFFu;
+
+	if (exponent == 0xFFu) {
+		// infinity stays infinity, NaN keeps a set mantissa bit
+		return static_cast<GLushort>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+	}
+
+	int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+	if (halfExponent >= 0x1F) {
+		return static_cast<GLushort>(sign | 0x7C00u);
+	}
+
+	if (halfExponent <= 0) {
+		if (halfExponent < -10) {
+			return static_cast<GLushort>(sign);
+		}
+		// denormal: shift the mantissa with its implicit bit into place
+		mantissa |= 0x800000u;
+		uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1u))) {
+			half++;
+		}
+		return static_cast<GLushort>(sign | half);
+	}
+
+	uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1FFFu;
+	if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+		half++;  // may carry into the exponent, which rounds up correctly
+	}
+	return static_cast<GLushort>(sign | half);
+}
@@ -0,0 +1,232 @@
+/**
+* @file VertexLayout.hpp
+* @brief Compile-time description of an interleaved vertex buffer.
+*
+* A VertexLayout lists its attributes once. Offsets and stride are
+* computed at compile time, and the same description packs vertices in
+* the loader (pack), sets up the VAO in Render (setAttributes) and binds
+* the shader inputs by name (VERTEX_SEMANTICS, see ShaderProgram).
+*
+* Adding a vertex format means adding a layout alias and a VertexFormat
+* entry in visitVertexLayout(), nothing else.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+/**
+* @enum VertexSemantic
+* @brief What an attribute holds. The value is its shader location.
+*/
+enum VertexSemantic : GLuint {
+	SEMANTIC_POSITION,
+	SEMANTIC_TEXCOORD,
+	SEMANTIC_COLOR,
+};
+
+/**
+* @struct VertexSemanticInfo
+* @brief Shader input name of a semantic and where the loader keeps it.
+*
+* `sourceOffset` is the first float of the semantic in the loader's
+* float build buffer (x,y,z,u,v,r,g,b).
+*/
+struct VertexSemanticInfo {
+	VertexSemantic semantic;
+	const char *name;
+	size_t sourceOffset;
+};
+
+inline constexpr std::array<VertexSemanticInfo, 3> VERTEX_SEMANTICS = {{
+	{SEMANTIC_POSITION, "aPos", 0},
+	{SEMANTIC_TEXCOORD, "aTex", 3},
+	{SEMANTIC_COLOR, "aColor", 5},
+}};
+
+/**
+* @brief True when every VERTEX_SEMANTICS entry sits at the index of its
+* semantic, which lookups by `VERTEX_SEMANTICS[semantic]` rely on.
+*/
+constexpr bool isVertexSemanticTableOrdered() {
+	for (size_t i = 0; i < VERTEX_SEMANTICS.size(); i++) {
+		if (VERTEX_SEMANTICS[i].semantic != i) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(isVertexSemanticTableOrdered(), "VERTEX_SEMANTICS must be listed in VertexSemantic order");
+
+inline constexpr size_t SOURCE_FLOATS_PER_VERTEX = 8;
+
+GLushort floatToHalf(GLfloat value);
+
+/**
+* Component encodings. Each provides the GL type, the byte size of one
+* component, whether GL normalizes it and encode() from a float that is
+* already in range ([0, 1] for the unorm types).
+*/
+namespace VertexEncoding {
+	struct Float32 {
+		using Type = GLfloat;
+		static constexpr GLenum GL_TYPE = GL_FLOAT;
+		static constexpr bool NORMALIZED = false;
+		static Type encode(GLfloat value) { return value; }
+	};
+
+	struct Half {
+		using Type = GLushort;
+		static constexpr GLenum GL_TYPE = GL_HALF_FLOAT;
+		static constexpr bool NORMALIZED = false;
+		static Type encode(GLfloat value) { return floatToHalf(value); }
+	};
+
+	struct Unorm16 {
+		using Type = GLushort;
+		static constexpr GLenum GL_TYPE = GL_UNSIGNED_SHORT;
+		static constexpr bool NORMALIZED = true;
+		static Type encode(GLfloat value) {
+			return static_cast<Type>(lrintf(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+		}
+	};
+
+	struct Unorm8 {
+		using Type = GLubyte;
+		static constexpr GLenum GL_TYPE = GL_UNSIGNED_BYTE;
+		static constexpr bool NORMALIZED = true;
+		static Type encode(GLfloat value) {
+			return static_cast<Type>(lrintf(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+		}
+	};
+}
+
+/**
+* @struct VertexAttribute
+* @brief One attribute: semantic, component encoding and count.
+*
+* Attributes are padded to 4 bytes, the alignment GL drivers expect for
+* vertex attributes.
+*/
+template <VertexSemantic Semantic, typename Encoding, GLint Components>
+struct VertexAttribute {
+	static constexpr VertexSemantic SEMANTIC = Semantic;
+	static constexpr GLint COMPONENTS = Components;
+	static constexpr size_t SIZE = (Components * sizeof(typename Encoding::Type) + 3) & ~size_t(3);
+	static constexpr size_t SOURCE_OFFSET = VERTEX_SEMANTICS[Semantic].sourceOffset;
+	using EncodingType = Encoding;
+
+	/**
+	* @brief Encodes the attribute of one vertex; positions are first
+	* mapped to [0, 1] through `offset` and `invScale` for unorm encodings.
+	*/
+	static void pack(const GLfloat *source, const GLfloat *offset, const GLfloat *invScale, GLubyte *dest) {
+		typename Encoding::Type values[Components];
+		for (GLint k = 0; k < Components; k++) {
+			GLfloat value = source[SOURCE_OFFSET + k];
+			if constexpr (Semantic == SEMANTIC_POSITION && Encoding::NORMALIZED) {
+				value = (value - offset[k]) * invScale[k];
+			}
+			values[k] = Encoding::encode(value);
+		}
+		memcpy(dest, values, sizeof(values));
+		memset(dest + sizeof(values), 0, SIZE - sizeof(values));
+	}
+};
+
+template <typename... Attributes>
+struct VertexLayout {
+	static constexpr size_t COUNT = sizeof...(Attributes);
+	static constexpr std::array<size_t, COUNT> SIZES = {Attributes::SIZE...};
+
+	static constexpr std::array<size_t, COUNT> getOffsets() {
+		std::array<size_t, COUNT> offsets = {};
+		for (size_t i = 1; i < COUNT; i++) {
+			offsets[i] = offsets[i - 1] + SIZES[i - 1];
+		}
+		return offsets;
+	}
+
+	static constexpr std::array<size_t, COUNT> OFFSETS = getOffsets();
+	static constexpr size_t STRIDE = (0 + ... + Attributes::SIZE);
+
+	// positions are stored relative to the bounds when their encoding is normalized
+	static constexpr bool BOUNDS_RELATIVE_POSITION =
+		((Attributes::SEMANTIC == SEMANTIC_POSITION && Attributes::EncodingType::NORMALIZED) || ...);
+
+	/**
+	* @brief Encodes one x,y,z,u,v,r,g,b source vertex into STRIDE bytes.
+	*/
+	static void pack(const GLfloat *source, const GLfloat *offset, const GLfloat *invScale, GLubyte *dest) {
+		size_t i = 0;
+		(Attributes::pack(source, offset, invScale, dest + OFFSETS[i++]), ...);
+	}
+
+	/**
+	* @brief Points and enables every attribute of the bound VAO at the
+	* bound GL_ARRAY_BUFFER.
+	*/
+	static void setAttributes() {
+		size_t i = 0;
+		(setAttribute<Attributes>(OFFSETS[i++]), ...);
+	}
+
+private:
+	template <typename Attribute>
+	static void setAttribute(size_t offset) {
+		using Encoding = typename Attribute::EncodingType;
+		glVertexAttribPointer(Attribute::SEMANTIC, Attribute::COMPONENTS, Encoding::GL_TYPE,
+			Encoding::NORMALIZED ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(STRIDE),
+			reinterpret_cast<const void *>(offset));
+		glEnableVertexAttribArray(Attribute::SEMANTIC);
+	}
+};
+
+using FloatVertexLayout = VertexLayout<
+	VertexAttribute<SEMANTIC_POSITION, VertexEncoding::Float32, 3>,
+	VertexAttribute<SEMANTIC_TEXCOORD, VertexEncoding::Float32, 2>,
+	VertexAttribute<SEMANTIC_COLOR, VertexEncoding::Float32, 3>>;
+
+using QuantizedVertexLayout = VertexLayout<
+	VertexAttribute<SEMANTIC_POSITION, VertexEncoding::Unorm16, 3>,
+	VertexAttribute<SEMANTIC_TEXCOORD, VertexEncoding::Half, 2>,
+	VertexAttribute<SEMANTIC_COLOR, VertexEncoding::Unorm8, 3>>;
+
+static_assert(FloatVertexLayout::STRIDE == 32, "float vertices are 8 floats");
+static_assert(QuantizedVertexLayout::STRIDE == 16, "quantized vertices are 16 bytes");
+
+/**
+* @enum VertexFormat
+* @brief Runtime tag of a vertex layout, stored in options and caches.
+*
+* - VERTEX_FLOAT: FloatVertexLayout (32 bytes).
+* - VERTEX_QUANTIZED: QuantizedVertexLayout (16 bytes). Positions are
+*   16-bit unorm within the bounding box, UVs half floats, colors 8-bit unorm.
+*/
+enum VertexFormat : uint32_t {
+	VERTEX_FLOAT,
+	VERTEX_QUANTIZED,
+};
+
+/**
+* @brief Calls `visit` with a value of the layout type of `format`.
+*/
+template <typename Visitor>
+decltype(auto) visitVertexLayout(VertexFormat format, Visitor &&visit) {
+	switch (format) {
+		case VERTEX_QUANTIZED: return visit(QuantizedVertexLayout());
+		case VERTEX_FLOAT:
+		default: return visit(FloatVertexLayout());
+	}
+}
+
+inline size_t getVertexStride(VertexFormat format) {
+	return visitVertexLayout(format, [](auto layout) { return decltype(layout)::STRIDE; });
+}
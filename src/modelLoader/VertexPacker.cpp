@@ -0,0 +1,16 @@
+#include "VertexPacker.hpp"
+#include "Mesh.hpp"
+#include <glad/gl.h>
+
+using namespace std;
+
+void VertexPacker::pack(const GLfloat *floats, size_t vertexCount, VertexFormat format, const PositionDecode &decode, GLubyte *out) {
+	const GLfloat invScale[3] = {1.0f / decode.scale[0], 1.0f / decode.scale[1], 1.0f / decode.scale[2]};
+
+	visitVertexLayout(format, [&](auto layout) {
+		using Layout = decltype(layout);
+		for (size_t i = 0; i < vertexCount; i++) {
+			Layout::pack(floats + i * Mesh::FLOATS_PER_VERTEX, decode.offset, invScale, out + i * Layout::STRIDE);
+		}
+	});
+}
@@ -0,0 +1,21 @@
+/**
+* @file VertexPacker.hpp
+* @brief Encodes the float build buffer into the final VertexFormat.
+*/
+
+#pragma once
+
+#include "Mesh.hpp"
+#include <glad/gl.h>
+#include <cstddef>
+
+namespace VertexPacker {
+	/**
+	* @brief Packs `vertexCount` x,y,z,u,v,r,g,b float vertices into the
+	* VertexLayout of `format`; `out` receives vertexCount * stride bytes.
+	*
+	* `decode` must be PositionDecode::fromBounds() of bounds that enclose
+	* every position, the quantized positions are stored relative to it.
+	*/
+	void pack(const GLfloat *floats, size_t vertexCount, VertexFormat format, const PositionDecode &decode, GLubyte *out);
+}
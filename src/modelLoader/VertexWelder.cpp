@@ -0,0 +1,70 @@
+#include "VertexWelder.hpp"
+#include <glad/gl.h>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+VertexWelder::VertexWelder(size_t expectedCorners) {
+	// keep the load factor at or below 1/2 for the expected vertex count
+	size_t capacity = 64;
+	while (capacity < expectedCorners * 2) {
+		capacity <<= 1;
+	}
+
+	_table.assign(capacity, EMPTY);
+	_mask = capacity - 1;
+	_keys.reserve(expectedCorners);
+}
+
+/**
+* @brief Returns the vertex index of `key`, adding it if it is new.
+* @param inserted Set to true when the key was not seen before.
+*/
+GLuint VertexWelder::weld(const VertexKey &key, bool &inserted) {
+	size_t slot = hash(key) & _mask;
+
+	while (_table[slot] != EMPTY) {
+		if (_keys[_table[slot]] == key) {
+			inserted = false;
+			return _table[slot];
+		}
+		slot = (slot + 1) & _mask;
+	}
+
+	GLuint index = static_cast<GLuint>(_keys.size());
+	_table[slot] = index;
+	_keys.push_back(key);
+	inserted = true;
+
+	if (_keys.size() * 2 > _table.size()) {
+		grow();
+	}
+	return index;
+}
+
+const vector<VertexKey> &VertexWelder::getUniqueKeys() const {
+	return _keys;
+}
+
+// private //
+
+size_t VertexWelder::hash(const VertexKey &key) {
+	uint64_t h = key.v * 0x9E3779B97F4A7C15ull;
+	h ^= (h >> 29) + key.vt * 0xBF58476D1CE4E5B9ull;
+	h ^= (h >> 31) + key.vn * 0x94D049BB133111EBull;
+	return static_cast<size_t>(h ^ (h >> 32));
+}
+
+void VertexWelder::grow() {
+	_table.assign(_table.size() * 2, EMPTY);
+	_mask = _table.size() - 1;
+
+	for (GLuint index = 0; index < _keys.size(); index++) {
+		size_t slot = hash(_keys[index]) & _mask;
+		while (_table[slot] != EMPTY) {
+			slot = (slot + 1) & _mask;
+		}
+		_table[slot] = index;
+	}
+}
@@ -0,0 +1,53 @@
+/**
+* @file VertexWelder.hpp
+* @brief Hash-based welding of (v, vt, vn) face corners into unique vertices.
+*/
+
+#pragma once
+
+#include <glad/gl.h>
+#include <vector>
+#include <cstddef>
+
+/**
+* @struct VertexKey
+* @brief The OBJ indices that fully determine one output vertex.
+*/
+struct VertexKey {
+	GLuint v = 0;
+	GLuint vt = 0;
+	GLuint vn = 0;
+
+	bool operator==(const VertexKey &other) const {
+		return v == other.v && vt == other.vt && vn == other.vn;
+	}
+};
+
+/**
+* @class VertexWelder
+* @brief Maps face corners to vertex indices, one per distinct VertexKey.
+*
+* Uses an open-addressing table of vertex indices into the list of unique
+* keys, so the only per-vertex storage is the key itself. Vertices are
+* numbered in first-use order.
+*/
+class VertexWelder {
+public:
+	explicit VertexWelder(size_t expectedCorners);
+
+	GLuint weld(const VertexKey &key, bool &inserted);
+
+	const std::vector<VertexKey> &getUniqueKeys() const;
+
+private:
+	static constexpr GLuint EMPTY = 0xFFFFFFFFu;
+
+	std::vector<GLuint> _table;
+	std::vector<VertexKey> _keys;
+	size_t _mask;
+
+	static size_t hash(const VertexKey &key);
+	void grow();
+
+	VertexWelder();
+};
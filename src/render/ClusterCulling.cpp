@@ -0,0 +1,101 @@
+#include "ClusterCulling.hpp"
+#include "../matrixMath/MatrixTransform.hpp"
+#include "../modelLoader/Mesh.hpp"
+#include <glad/gl.h>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+/**
+* @brief Extracts the planes of clip = projection * view * model (Gribb, Hartmann).
+*
+* The camera is the center of projection: the model-space point whose
+* clip x, y and w are all zero. It is solved from the same matrix, so it
+* matches whatever projection the shader applies.
+*/
+CullView CullView::fromMatrices(const GLfloat *model, const GLfloat *view, const GLfloat *projection) {
+	GLfloat modelView[16], clip[16];
+	GLfloat m[16], v[16], p[16];
+	memcpy(m, model, sizeof(m));
+	memcpy(v, view, sizeof(v));
+	memcpy(p, projection, sizeof(p));
+	MatrixTransform::multiply(v, m, modelView);
+	MatrixTransform::multiply(p, modelView, clip);
+
+	CullView cull;
+	const GLfloat *w = &clip[12];
+	for (int axis = 0; axis < 3; axis++) {
+		const GLfloat *row = &clip[axis * 4];
+		for (int c = 0; c < 4; c++) {
+			cull.planes[axis * 2][c] = w[c] + row[c];
+			cull.planes[axis * 2 + 1][c] = w[c] - row[c];
+		}
+	}
+	for (GLfloat *plane : cull.planes) {
+		GLfloat length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f) {
+			for (int c = 0; c < 4; c++) {
+				plane[c] /= length;
+			}
+		}
+	}
+
+	// Cramer's rule on rows x, y, w of clip
+	const GLfloat *r0 = &clip[0], *r1 = &clip[4], *r3 = &clip[12];
+	auto det3 = [](const GLfloat *a, const GLfloat *b, const GLfloat *c) {
+		return a[0] * (b[1] * c[2] - b[2] * c[1]) - a[1] * (b[0] * c[2] - b[2] * c[0])
+			+ a[2] * (b[0] * c[1] - b[1] * c[0]);
+	};
+	GLfloat det = det3(r0, r1, r3);
+	cull.coneCulling = fabs(det) > 1e-12f;
+	for (int c = 0; c < 3 && cull.coneCulling; c++) {
+		GLfloat a[3] = {r0[0], r0[1], r0[2]};
+		GLfloat b[3] = {r1[0], r1[1], r1[2]};
+		GLfloat d[3] = {r3[0], r3[1], r3[2]};
+		a[c] = -r0[3];
+		b[c] = -r1[3];
+		d[c] = -r3[3];
+		cull.cameraPosition[c] = det3(a, b, d) / det;
+	}
+	return cull;
+}
+
+/**
+* @brief false if the cluster is outside a frustum plane or faces away
+* from the camera as a whole.
+*/
+bool CullView::isVisible(const MeshCluster &cluster) const {
+	if (!isInFrustum(cluster.center, cluster.radius)) {
+		return false;
+	}
+
+	if (!coneCulling) {
+		return true;
+	}
+
+	GLfloat toCenter[3] = {
+		cluster.center[0] - cameraPosition[0],
+		cluster.center[1] - cameraPosition[1],
+		cluster.center[2] - cameraPosition[2],
+	};
+	GLfloat distance = sqrt(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+	GLfloat along = toCenter[0] * cluster.coneAxis[0] + toCenter[1] * cluster.coneAxis[1]
+		+ toCenter[2] * cluster.coneAxis[2];
+	return along < cluster.coneCutoff * distance + cluster.radius;
+}
+
+// submeshes are only culled by the frustum, their faces point anywhere
+bool CullView::isVisible(const MeshSubmesh &submesh) const {
+	return isInFrustum(submesh.center, submesh.radius);
+}
+
+bool CullView::isInFrustum(const GLfloat *center, GLfloat radius) const {
+	for (const GLfloat *plane : planes) {
+		GLfloat distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		if (distance < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,30 @@
+/**
+* @file ClusterCulling.hpp
+* @brief Frustum and back-face tests of MeshClusters and MeshSubmeshes against the current view.
+*/
+
+#pragma once
+
+#include "../modelLoader/Mesh.hpp"
+#include <glad/gl.h>
+
+/**
+* @struct CullView
+* @brief The view frustum and the camera position, both in model space.
+*
+* Built once per frame from the row-major model, view and projection
+* matrices (the ones uploaded with GL_TRUE), so clusters are tested in
+* the space their bounds were computed in. Cone tests need a center of
+* projection and are skipped for parallel projections.
+*/
+struct CullView {
+	GLfloat planes[6][4];      // a, b, c, d with a*x + b*y + c*z + d >= 0 inside, normalized
+	GLfloat cameraPosition[3] = {0.0f, 0.0f, 0.0f};
+	bool coneCulling = false;
+
+	static CullView fromMatrices(const GLfloat *model, const GLfloat *view, const GLfloat *projection);
+
+	bool isVisible(const MeshCluster &cluster) const;
+	bool isVisible(const MeshSubmesh &submesh) const;
+	bool isInFrustum(const GLfloat *center, GLfloat radius) const;
+};
@@ -1,6 +1,14 @@
 #include "Render.hpp"
 #include <exception>
 #include <vector>
+#include <span>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <string>
+#include <unordered_map>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 #include "../shaders/ShaderProgram.hpp"
@@ -18,52 +26,403 @@ const char *RenderException::what() const noexcept {
 	}
 }
 
-Render::Render(const Mesh &mesh, ShaderProgram &shaderProgram)
-	:  _mesh(mesh), _shaderProgram(shaderProgram)
+bool MaterialBinding::operator==(const MaterialBinding &other) const {
+	return texture == other.texture && equal(diffuse, diffuse + 3, other.diffuse);
+}
+
+// groups equal bindings, textures first since they cost the most to switch
+bool MaterialBinding::operator<(const MaterialBinding &other) const {
+	if (texture != other.texture) {
+		return texture < other.texture;
+	}
+	return lexicographical_compare(diffuse, diffuse + 3, other.diffuse, other.diffuse + 3);
+}
+
+/**
+* @brief Uploads the mesh and keeps only its DrawDescriptor.
+*
+* `buffers` is taken by value, so its CPU buffers are released when the
+* constructor returns. Later meshes can arrive in frame sized steps, see
+* beginUpload().
+*/
+Render::Render(MeshBuffers buffers, ShaderProgram &shaderProgram)
+	:  _shaderProgram(shaderProgram)
 {
+	// Sets the color that will be used when clearing the screen
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	// These commands set up the coordinates of the triangle to be rendered.
-	// They tell OpenGL the location in memory that the positions of the triangle will come from
+	glSettings();
+	uploadUniforms();
 
-	glGenVertexArrays(1, &_VAO);
-	glBindVertexArray(_VAO);
+	beginUpload(move(buffers));
+	continueUpload(numeric_limits<double>::infinity());
+}
 
-	glGenBuffers(1, &_VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, _VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * _mesh.vertices.size(), _mesh.vertices.data(), GL_STATIC_DRAW);
+/**
+* @brief Starts moving `buffers` to the GPU next to the current mesh.
+*
+* Only the buffer storage is allocated here; continueUpload() fills it
+* and swaps the new mesh in once everything arrived. The current mesh
+* is drawn until then. An unfinished earlier upload is dropped.
+*/
+void Render::beginUpload(MeshBuffers buffers) {
+	MeshUpload &upload = allocateUpload(move(buffers));
+	if (size_t vertexCount = upload.buffers.getVertexCount()) {
+		upload.vertexRanges.push_back({0, vertexCount});
+	}
+	if (size_t indexCount = upload.buffers.getIndices().size()) {
+		upload.indexRanges.push_back({0, indexCount});
+	}
+}
 
-	int stride = 11 * sizeof(GLfloat);
+/**
+* @brief Replaces the pending upload by `buffers`, with GPU buffers of
+* their size and no ranges to upload yet.
+*/
+MeshUpload &Render::allocateUpload(MeshBuffers buffers) {
+	if (_upload) {
+		glDeleteBuffers(1, &_upload->VBO);
+		glDeleteBuffers(1, &_upload->EBO);
+	}
+	_upload.emplace(MeshUpload{move(buffers)});
+	MeshUpload &upload = *_upload;
 
-	// Position attribute (location = 0)
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-	glEnableVertexAttribArray(0);
+	// GL_COPY_WRITE_BUFFER is not VAO state, the bound VAO stays untouched
+	glGenBuffers(1, &upload.VBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, upload.VBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, upload.buffers.getVertexCount() * getVertexStride(upload.buffers.getFormat()),
+		nullptr, GL_STATIC_DRAW);
 
-	// Texture coord attribute (location = 1)
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	glGenBuffers(1, &upload.EBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, upload.EBO);
+	glBufferData(GL_COPY_WRITE_BUFFER, upload.buffers.getIndices().size_bytes(), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return upload;
+}
 
-	// Vertex color attribute (location = 2)
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(5 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+/**
+* @brief Uploads chunks of the pending mesh until `budgetSeconds` passed.
+*
+* At least one chunk of UPLOAD_CHUNK_BYTES goes up per call, vertices
+* first, then indices. Call it before renderFrame(): when the last chunk
+* is done the new mesh replaces the current one.
+*
+* @return true when no upload is pending anymore.
+*/
+bool Render::continueUpload(double budgetSeconds) {
+	if (!_upload) {
+		return true;
+	}
 
-	// Face color attribute (location = 3)
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
-	glEnableVertexAttribArray(3);
+	MeshUpload &upload = *_upload;
+	const auto start = chrono::steady_clock::now();
 
-	glGenBuffers(1, &_EBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * _mesh.indices.size(), _mesh.indices.data(), GL_STATIC_DRAW);
+	while (upload.vertexRange < upload.vertexRanges.size() || upload.indexRange < upload.indexRanges.size()) {
+		if (upload.vertexRange < upload.vertexRanges.size()) {
+			uploadVertexChunk(upload);
+		} else {
+			uploadIndexChunk(upload);
+		}
+		if (chrono::duration<double>(chrono::steady_clock::now() - start).count() >= budgetSeconds) {
+			break;
+		}
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 
-	// Sets the color that will be used when clearing the screen
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	if (upload.vertexRange < upload.vertexRanges.size() || upload.indexRange < upload.indexRanges.size()) {
+		return false;
+	}
+	finishUpload();
+	return true;
+}
 
-	glSettings();
+bool Render::isUploading() const {
+	return _upload.has_value();
+}
+
+/**
+* @brief Takes the next chunk of up to `maxCount` elements of the current
+* range and moves on, to the next range once this one is done.
+*/
+static UploadRange takeRangeChunk(const vector<UploadRange> &ranges, size_t &range, size_t &cursor, size_t maxCount) {
+	const UploadRange &current = ranges[range];
+	UploadRange chunk;
+	chunk.first = max(cursor, current.first);
+	chunk.count = min(maxCount, current.first + current.count - chunk.first);
+	cursor = chunk.first + chunk.count;
+	if (cursor == current.first + current.count) {
+		range++;
+	}
+	return chunk;
+}
+
+/**
+* @brief Writes the next UPLOAD_CHUNK_BYTES of vertices.
+*
+* Packed buffers are copied with glBufferSubData(). Deferred ones are
+* packed straight into a mapped range, so no packed CPU copy of the mesh
+* exists. A range that cannot be mapped, or whose contents are lost on
+* unmap, goes through a staging chunk and glBufferSubData() instead.
+*/
+void Render::uploadVertexChunk(MeshUpload &upload) {
+	const MeshBuffers &buffers = upload.buffers;
+	const size_t stride = getVertexStride(buffers.getFormat());
+	const UploadRange chunk = takeRangeChunk(upload.vertexRanges, upload.vertexRange, upload.vertices,
+		max<size_t>(1, UPLOAD_CHUNK_BYTES / stride));
+	const size_t first = chunk.first;
+	const size_t count = chunk.count;
+	const GLintptr offset = static_cast<GLintptr>(first * stride);
+	const GLsizeiptr bytes = static_cast<GLsizeiptr>(count * stride);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, upload.VBO);
+	if (buffers.isPacked()) {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, buffers.getView().vertices.data() + offset);
+		return;
+	}
+
+	void *dest = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (dest) {
+		buffers.packVertices(first, count, static_cast<GLubyte *>(dest));
+		if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE) {
+			return;
+		}
+	}
+
+	_staging.resize(count * stride);
+	buffers.packVertices(first, count, _staging.data());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, _staging.data());
+}
+
+void Render::uploadIndexChunk(MeshUpload &upload) {
+	span<const GLuint> indices = upload.buffers.getIndices();
+	const UploadRange chunk = takeRangeChunk(upload.indexRanges, upload.indexRange, upload.indices,
+		UPLOAD_CHUNK_BYTES / sizeof(GLuint));
+	const size_t first = chunk.first;
+	const size_t count = chunk.count;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, upload.EBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(first * sizeof(GLuint)),
+		static_cast<GLsizeiptr>(count * sizeof(GLuint)), indices.data() + first);
+}
+
+/**
+* @brief Wraps the uploaded buffers into a VAO, swaps them in for the
+* current mesh and drops the CPU side of the upload.
+*/
+void Render::finishUpload() {
+	MeshUpload &upload = *_upload;
+	const MeshBuffers &buffers = upload.buffers;
+
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, upload.VBO);
+	setVertexAttributes(buffers.getFormat());
+	// Face colors come from gl_PrimitiveID in the fragment shader
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, upload.EBO);
 
 	// Unbind
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	uploadUniforms();
+	glDeleteVertexArrays(1, &_VAO);
+	glDeleteBuffers(1, &_EBO);
+	glDeleteBuffers(1, &_VBO);
+	_VAO = vao;
+	_VBO = upload.VBO;
+	_EBO = upload.EBO;
+
+	setDrawDescriptor(buffers);
+	_resident = buffers.getBlockHashes();
+
+	_upload.reset();
+	vector<GLubyte>().swap(_staging);
+}
+
+void Render::setDrawDescriptor(const MeshBuffers &buffers) {
+	span<const GLuint> indices = buffers.getIndices();
+	_draw.indexCount = static_cast<GLsizei>(indices.size());
+	_draw.bounds = buffers.getBounds();
+	_draw.decode = PositionDecode::fromBounds(_draw.bounds, buffers.getFormat());
+	span<const MeshLod> lods = buffers.getLods();
+	_draw.lods.assign(lods.begin(), lods.end());
+	if (_draw.lods.empty()) {
+		_draw.lods.push_back({0, static_cast<GLuint>(indices.size()), 0.0f});
+	}
+	span<const MeshCluster> clusters = buffers.getClusters();
+	_draw.clusters.assign(clusters.begin(), clusters.end());
+
+	MeshView view = buffers.getView();
+	_draw.submeshes.assign(view.submeshes.begin(), view.submeshes.end());
+	_draw.submeshLods.assign(view.submeshLods.begin(), view.submeshLods.end());
+	_draw.names.assign(view.names.begin(), view.names.end());
+	resolveMaterials();
+}
+
+// runs of blocks whose hashes differ, in elements of the buffer
+static vector<UploadRange> findChangedRanges(const vector<uint64_t> &hashes, const vector<uint64_t> &resident,
+	size_t blockSize, size_t total)
+{
+	vector<UploadRange> ranges;
+	for (size_t block = 0; block < hashes.size(); block++) {
+		if (hashes[block] == resident[block]) {
+			continue;
+		}
+		const size_t first = block * blockSize;
+		const size_t count = min(blockSize, total - first);
+		if (!ranges.empty() && ranges.back().first + ranges.back().count == first) {
+			ranges.back().count += count;
+		} else {
+			ranges.push_back({first, count});
+		}
+	}
+	return ranges;
+}
+
+/**
+* @brief Replaces the current mesh by `buffers`, a new version of it.
+*
+* When both versions carry block hashes of the same layout (see
+* MeshBuffers::hashBlocks()), only the blocks whose hashes differ are
+* uploaded. Up to IN_PLACE_UPDATE_BYTES, about what one frame may upload,
+* they are written into the resident buffers with glBufferSubData() right
+* away. Larger edits would stall the frame, so the resident buffers are
+* copied on the GPU instead and the changed blocks go into the copy in
+* frame sized chunks, see continueUpload(); the current mesh is drawn
+* unchanged until the copy is complete. Meshes of another size or
+* format, meshes without hashes and updates during an upload go through
+* beginUpload().
+*/
+MeshUpdate Render::updateMesh(MeshBuffers buffers) {
+	const BlockHashes &hashes = buffers.getBlockHashes();
+	MeshUpdate update;
+	if (_upload || !hashes.isComparable(_resident)) {
+		beginUpload(move(buffers));
+		return update;
+	}
+
+	const size_t stride = getVertexStride(hashes.format);
+	const size_t vertexBytes = hashes.vertexCount * stride;
+	const size_t indexBytes = hashes.indexCount * sizeof(GLuint);
+	update.partial = true;
+	update.totalBytes = vertexBytes + indexBytes;
+
+	vector<UploadRange> vertexRanges = findChangedRanges(hashes.vertices, _resident.vertices,
+		hashes.blockVertices, hashes.vertexCount);
+	vector<UploadRange> indexRanges = findChangedRanges(hashes.indices, _resident.indices,
+		hashes.blockIndices, hashes.indexCount);
+	for (const UploadRange &range : vertexRanges) {
+		update.changedBytes += range.count * stride;
+	}
+	for (const UploadRange &range : indexRanges) {
+		update.changedBytes += range.count * sizeof(GLuint);
+	}
+
+	if (update.changedBytes <= IN_PLACE_UPDATE_BYTES) {
+		updateInPlace(buffers, vertexRanges, indexRanges);
+		setDrawDescriptor(buffers);
+		_resident = hashes;
+		return update;
+	}
+
+	// `hashes` moves along with the buffers
+	MeshUpload &upload = allocateUpload(move(buffers));
+	upload.vertexRanges = move(vertexRanges);
+	upload.indexRanges = move(indexRanges);
+
+	// the unchanged blocks never leave the GPU
+	glBindBuffer(GL_COPY_READ_BUFFER, _VBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, upload.VBO);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(vertexBytes));
+	glBindBuffer(GL_COPY_READ_BUFFER, _EBO);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, upload.EBO);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(indexBytes));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return update;
+}
+
+/**
+* @brief Writes `vertexRanges` and `indexRanges` of `buffers` into the
+* resident buffers; deferred vertices are packed through the staging buffer.
+*/
+void Render::updateInPlace(const MeshBuffers &buffers, const vector<UploadRange> &vertexRanges,
+	const vector<UploadRange> &indexRanges)
+{
+	const size_t stride = getVertexStride(buffers.getFormat());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _VBO);
+	for (const UploadRange &range : vertexRanges) {
+		const GLubyte *data;
+		if (buffers.isPacked()) {
+			data = buffers.getView().vertices.data() + range.first * stride;
+		} else {
+			_staging.resize(range.count * stride);
+			buffers.packVertices(range.first, range.count, _staging.data());
+			data = _staging.data();
+		}
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.first * stride),
+			static_cast<GLsizeiptr>(range.count * stride), data);
+	}
+
+	span<const GLuint> indices = buffers.getIndices();
+	glBindBuffer(GL_COPY_WRITE_BUFFER, _EBO);
+	for (const UploadRange &range : indexRanges) {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.first * sizeof(GLuint)),
+			static_cast<GLsizeiptr>(range.count * sizeof(GLuint)), indices.data() + range.first);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	vector<GLubyte>().swap(_staging);
+}
+
+/**
+* @brief Sets the materials submeshes are drawn with, by the name of
+* their `usemtl` statement.
+*
+* Submeshes whose material is not in `materials`, and meshes without
+* submeshes, use `fallback`. Applies to the current mesh and every later
+* one, so it may come before the mesh it belongs to.
+*/
+void Render::setMaterials(unordered_map<string, MaterialBinding> materials, const MaterialBinding &fallback) {
+	_materials = move(materials);
+	_fallbackMaterial = fallback;
+	resolveMaterials();
+}
+
+/**
+* @brief Looks up the material of every submesh and orders the submeshes
+* by it, so that drawMesh() switches textures once per distinct material.
+*/
+void Render::resolveMaterials() {
+	const size_t submeshCount = _draw.submeshes.size();
+	_submeshMaterials.assign(submeshCount, _fallbackMaterial);
+	for (size_t s = 0; s < submeshCount; s++) {
+		auto it = _materials.find(&_draw.names[_draw.submeshes[s].materialOffset]);
+		if (it != _materials.end()) {
+			_submeshMaterials[s] = it->second;
+		}
+	}
+
+	_submeshOrder.resize(submeshCount);
+	for (size_t s = 0; s < submeshCount; s++) {
+		_submeshOrder[s] = s;
+	}
+	// stable: within a material submeshes stay in index order, and neighbours still merge
+	stable_sort(_submeshOrder.begin(), _submeshOrder.end(), [this](size_t a, size_t b) {
+		return _submeshMaterials[a] < _submeshMaterials[b];
+	});
+}
+
+/**
+* @brief Describes the VertexLayout of `format` to the bound VAO.
+*
+* The shader sees the same inputs for every format: normalized positions
+* arrive as [0, 1] and are mapped back with the positionOffset and
+* positionScale uniforms, which are identity for float positions.
+*/
+void Render::setVertexAttributes(VertexFormat format) {
+	visitVertexLayout(format, [](auto layout) {
+		decltype(layout)::setAttributes();
+	});
 }
 
 // getters //
@@ -76,6 +435,38 @@ GLuint Render::getVAO() const {
 	return _VAO;
 }
 
+GLsizei Render::getIndexCount() const {
+	return _draw.indexCount;
+}
+
+const DrawDescriptor &Render::getDrawDescriptor() const {
+	return _draw;
+}
+
+/**
+* @brief Index of the coarsest level of detail whose error stays below
+* LOD_PIXEL_ERROR.
+*
+* The model-space error of a level is scaled by the model scale and
+* projected at the model's distance from the camera, which looks down -Z
+* from the origin: pixels = error * scale * projection[1][1] * height / 2 / depth.
+*/
+size_t Render::selectLod(const Transformation &transformation, const Camera &camera) const {
+	const GLfloat depth = max(-transformation.transform.translationZ, camera.near);
+	const GLfloat pixelsPerUnit = transformation.transform.scaleFactor * camera.projectionMatrix[5]
+		* camera.height * 0.5f / depth;
+
+	size_t level = 0;
+	while (level + 1 < _draw.lods.size() && _draw.lods[level + 1].error * pixelsPerUnit <= LOD_PIXEL_ERROR) {
+		level++;
+	}
+	return level;
+}
+
+const CullStats &Render::getCullStats() const {
+	return _cullStats;
+}
+
 // other //
 
 void Render::uploadUniforms() {
@@ -86,6 +477,10 @@ void Render::uploadUniforms() {
 	_uniformLocations.modelMatrix = glGetUniformLocation(_shaderProgram.getShaderProgram(), "modelMatrix");
 	_uniformLocations.viewMatrix = glGetUniformLocation(_shaderProgram.getShaderProgram(), "viewMatrix");
 	_uniformLocations.projectionMatrix = glGetUniformLocation(_shaderProgram.getShaderProgram(), "projectionMatrix");
+	_uniformLocations.positionOffset = glGetUniformLocation(_shaderProgram.getShaderProgram(), "positionOffset");
+	_uniformLocations.positionScale = glGetUniformLocation(_shaderProgram.getShaderProgram(), "positionScale");
+	_uniformLocations.primitiveBase = glGetUniformLocation(_shaderProgram.getShaderProgram(), "primitiveBase");
+	_uniformLocations.diffuseColor = glGetUniformLocation(_shaderProgram.getShaderProgram(), "diffuseColor");
 }
 
 void Render::glSettings() {
@@ -100,6 +495,12 @@ void Render::glSettings() {
 }
 
 void Render::cleanUp() {
+	if (_upload) {
+		glDeleteBuffers(1, &_upload->VBO);
+		glDeleteBuffers(1, &_upload->EBO);
+		_upload.reset();
+	}
+	_resident = BlockHashes();
 	glDeleteVertexArrays(1, &_VAO);
 	glDeleteBuffers(1, &_EBO);
 	glDeleteBuffers(1, &_VBO);
@@ -11,6 +11,7 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <optional>
 
 class RenderException : public std::exception {
 public:
@@ -32,25 +33,155 @@ struct ShaderUniforms {
     GLint modelMatrix;
     GLint viewMatrix;
     GLint projectionMatrix;
+    GLint positionOffset;
+    GLint positionScale;
+    GLint primitiveBase;
+    GLint diffuseColor;
+};
+
+/**
+* @struct MaterialBinding
+* @brief The GL state a material needs: its texture and Kd color.
+*/
+struct MaterialBinding {
+	GLuint texture = 0;
+	GLfloat diffuse[3] = {1.0f, 1.0f, 1.0f};
+
+	bool operator==(const MaterialBinding &other) const;
+	bool operator<(const MaterialBinding &other) const;
+};
+
+/**
+* @struct CullStats
+* @brief What the last drawMesh() call submitted.
+*/
+struct CullStats {
+	size_t submeshes = 0;
+	size_t visibleSubmeshes = 0;
+	size_t clusters = 0;
+	size_t visibleClusters = 0;
+	size_t triangles = 0;
+	size_t visibleTriangles = 0;
+	size_t drawRanges = 0;
+	size_t drawCalls = 0;
+	size_t materialBinds = 0;
+};
+
+/**
+* @struct DrawDescriptor
+* @brief What drawing needs to know about a mesh once its buffers live on the GPU.
+*
+* `lods` always holds at least level 0, the full mesh. `clusters` are in
+* index order, so the clusters of a level, and of a submesh within it,
+* are one contiguous run. Without `submeshes` a level is one range.
+*/
+struct DrawDescriptor {
+	GLsizei indexCount = 0;
+	BoundingBox bounds;
+	PositionDecode decode;
+	std::vector<MeshLod> lods;
+	std::vector<MeshCluster> clusters;
+	std::vector<MeshSubmesh> submeshes;
+	std::vector<MeshLod> submeshLods;  // see Mesh::submeshLods
+	std::vector<char> names;
+};
+
+/**
+* @struct MeshUpdate
+* @brief How a Render::updateMesh() call gets the new version to the GPU.
+*/
+struct MeshUpdate {
+	bool partial = false;     // false: the whole mesh goes up, as after beginUpload()
+	size_t changedBytes = 0;  // of changed blocks, written right away or by continueUpload()
+	size_t totalBytes = 0;    // size of the resident buffers
+};
+
+/**
+* @struct UploadRange
+* @brief Elements [first, first + count) of a buffer.
+*/
+struct UploadRange {
+	size_t first = 0;
+	size_t count = 0;
+};
+
+/**
+* @struct MeshUpload
+* @brief A mesh on its way to the GPU, see Render::beginUpload().
+*
+* Only the listed ranges are uploaded, in order: the whole buffers for a
+* new mesh, the changed blocks for an update (see Render::updateMesh()).
+*/
+struct MeshUpload {
+	MeshBuffers buffers;
+	GLuint VBO = 0;
+	GLuint EBO = 0;
+	std::vector<UploadRange> vertexRanges = {};
+	std::vector<UploadRange> indexRanges = {};
+	size_t vertexRange = 0;  // current range
+	size_t indexRange = 0;
+	size_t vertices = 0;     // next element of the current range
+	size_t indices = 0;
 };
 
 class Render {
 public:
-	explicit Render(const Mesh &mesh, ShaderProgram &shaderProgram);
+	static constexpr double UPLOAD_FRAME_SECONDS = 0.004;  // upload time a frame may spend
+
+	explicit Render(MeshBuffers buffers, ShaderProgram &shaderProgram);
+
+	void beginUpload(MeshBuffers buffers);
+	bool continueUpload(double budgetSeconds = UPLOAD_FRAME_SECONDS);
+	bool isUploading() const;
+	MeshUpdate updateMesh(MeshBuffers buffers);
+	void setMaterials(std::unordered_map<std::string, MaterialBinding> materials, const MaterialBinding &fallback);
 
 	void uploadUniforms();
 	const ShaderUniforms &getUniformLocation() const;
 	GLuint getVAO() const;
+	GLsizei getIndexCount() const;
+	const DrawDescriptor &getDrawDescriptor() const;
+	size_t selectLod(const Transformation &transformation, const Camera &camera) const;
+	const CullStats &getCullStats() const;
 	void glSettings();
 	void cleanUp();
 
 	void renderFrame(double deltaTime, Transformation &transformation, Camera &camera, Material &material);
+	void drawMesh(const Transformation &transformation, const Camera &camera);
 
 private:
-	Mesh _mesh;
 	ShaderProgram _shaderProgram;
-	GLuint _VAO, _VBO, _EBO;
+	GLuint _VAO = 0, _VBO = 0, _EBO = 0;
+	DrawDescriptor _draw;
+	std::optional<MeshUpload> _upload;
+	BlockHashes _resident;  // of the mesh in _VBO/_EBO
+	std::vector<GLubyte> _staging;
 	ShaderUniforms _uniformLocations;
+	std::vector<MeshLod> _drawRanges;  // per-frame index ranges, error unused
+	std::vector<GLsizei> _drawCounts;  // _drawRanges for glMultiDrawElements()
+	std::vector<const void *> _drawOffsets;
+	bool _faceColorsShown = false;     // draws need their primitiveBase, see drawMesh()
+	CullStats _cullStats;
+	std::unordered_map<std::string, MaterialBinding> _materials;  // by material name
+	MaterialBinding _fallbackMaterial;        // for names without a material
+	std::vector<MaterialBinding> _submeshMaterials;
+	std::vector<size_t> _submeshOrder;       // submeshes sorted by material, see resolveMaterials()
+
+	static constexpr size_t UPLOAD_CHUNK_BYTES = 1 << 20;
+	static constexpr size_t IN_PLACE_UPDATE_BYTES = UPLOAD_CHUNK_BYTES;  // see updateMesh()
+	static constexpr GLfloat LOD_PIXEL_ERROR = 1.0f;  // largest on-screen LOD error, in pixels
+
+	MeshUpload &allocateUpload(MeshBuffers buffers);
+	void uploadVertexChunk(MeshUpload &upload);
+	void uploadIndexChunk(MeshUpload &upload);
+	void finishUpload();
+	void updateInPlace(const MeshBuffers &buffers, const std::vector<UploadRange> &vertexRanges,
+		const std::vector<UploadRange> &indexRanges);
+	void setDrawDescriptor(const MeshBuffers &buffers);
+	void resolveMaterials();
+	void bindMaterial(const MaterialBinding &material);
+	void submitDrawRanges(const MeshLod &lod);
+	void setVertexAttributes(VertexFormat format);
 
 	Render();
 };
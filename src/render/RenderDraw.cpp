@@ -2,6 +2,11 @@
 #include "../scene/Transformation.hpp"
 #include "../scene/Camera.hpp"
 #include "../scene/Material.hpp"
+#include "ClusterCulling.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace std;
 
 void Render::renderFrame(double deltaTime, Transformation &transformation, Camera &camera, Material &material) {
 
@@ -30,9 +35,126 @@ void Render::renderFrame(double deltaTime, Transformation &transformation, Camer
 			material.materialBlend.mixValue = material.materialBlend.targetMixValue;
 	}
 
+	_faceColorsShown = material.materialBlend.faceColorMode && material.materialBlend.mixValue < 1.0f;
+
 	glUniformMatrix4fv(getUniformLocation().modelMatrix, 1, GL_TRUE, transformation.modelMatrix);
 	glUniformMatrix4fv(getUniformLocation().viewMatrix, 1, GL_TRUE, camera.viewMatrix);
 	glUniformMatrix4fv(getUniformLocation().projectionMatrix, 1, GL_TRUE, camera.projectionMatrix);
+	glUniform3fv(getUniformLocation().positionOffset, 1, _draw.decode.offset);
+	glUniform3fv(getUniformLocation().positionScale, 1, _draw.decode.scale);
 
 	glBindVertexArray(getVAO());
 }
+
+/**
+* @brief Draws the visible clusters of the selected level of detail.
+*
+* Submeshes outside the frustum are skipped with all their clusters.
+* Within the others, clusters outside the frustum or facing away as a
+* whole are skipped and neighbouring visible clusters are merged into one
+* range. A level or submesh without clusters is drawn as one range.
+*
+* Submeshes are visited sorted by material (see resolveMaterials()), and
+* the ranges collected under one material go out in one
+* glMultiDrawElements() call, so a frame binds each visible material
+* once. gl_PrimitiveID restarts with every range though, so while face
+* colors are on screen each range is drawn on its own with its first
+* triangle within the level as primitiveBase, and face colors do not
+* change with what is culled. Expects the VAO bound by renderFrame().
+*/
+void Render::drawMesh(const Transformation &transformation, const Camera &camera) {
+	const size_t level = selectLod(transformation, camera);
+	const MeshLod &lod = _draw.lods[level];
+	const size_t submeshCount = _draw.submeshes.size();
+	CullView cull = CullView::fromMatrices(transformation.modelMatrix, camera.viewMatrix, camera.projectionMatrix);
+
+	_drawRanges.clear();
+	_cullStats = CullStats();
+	_cullStats.submeshes = max<size_t>(submeshCount, 1);
+	const MaterialBinding *bound = nullptr;
+
+	for (size_t k = 0; k < _cullStats.submeshes; k++) {
+		const size_t s = submeshCount ? _submeshOrder[k] : 0;
+		const MeshLod &range = submeshCount ? _draw.submeshLods[level * submeshCount + s] : lod;
+		const MaterialBinding &material = submeshCount ? _submeshMaterials[s] : _fallbackMaterial;
+		const GLuint rangeEnd = range.firstIndex + range.indexCount;
+		auto first = lower_bound(_draw.clusters.begin(), _draw.clusters.end(), range.firstIndex,
+			[](const MeshCluster &cluster, GLuint index) { return cluster.firstIndex < index; });
+		auto last = lower_bound(first, _draw.clusters.end(), rangeEnd,
+			[](const MeshCluster &cluster, GLuint index) { return cluster.firstIndex < index; });
+
+		_cullStats.clusters += last - first;
+		_cullStats.triangles += range.indexCount / 3;
+		if (submeshCount && !cull.isVisible(_draw.submeshes[s])) {
+			continue;
+		}
+		_cullStats.visibleSubmeshes++;
+
+		if (!bound || !(*bound == material)) {
+			submitDrawRanges(lod);
+			bindMaterial(material);
+			bound = &material;
+		}
+
+		if (first == last) {
+			_cullStats.visibleTriangles += range.indexCount / 3;
+			_drawRanges.push_back(range);
+			continue;
+		}
+
+		for (auto it = first; it != last; ++it) {
+			if (!cull.isVisible(*it)) {
+				continue;
+			}
+			_cullStats.visibleClusters++;
+			_cullStats.visibleTriangles += it->indexCount / 3;
+
+			MeshLod *previous = _drawRanges.empty() ? nullptr : &_drawRanges.back();
+			if (previous && previous->firstIndex + previous->indexCount == it->firstIndex) {
+				previous->indexCount += it->indexCount;
+			} else {
+				_drawRanges.push_back({it->firstIndex, it->indexCount, 0.0f});
+			}
+		}
+	}
+	submitDrawRanges(lod);
+}
+
+void Render::bindMaterial(const MaterialBinding &material) {
+	glBindTexture(GL_TEXTURE_2D, material.texture);
+	glUniform3fv(_uniformLocations.diffuseColor, 1, material.diffuse);
+	_cullStats.materialBinds++;
+}
+
+/**
+* @brief Draws and clears the collected ranges of level `lod`, see drawMesh().
+*/
+void Render::submitDrawRanges(const MeshLod &lod) {
+	if (_drawRanges.empty()) {
+		return;
+	}
+	_cullStats.drawRanges += _drawRanges.size();
+
+	if (_faceColorsShown) {
+		for (const MeshLod &range : _drawRanges) {
+			glUniform1ui(_uniformLocations.primitiveBase, (range.firstIndex - lod.firstIndex) / 3);
+			glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), GL_UNSIGNED_INT,
+				reinterpret_cast<const void *>(range.firstIndex * sizeof(GLuint)));
+		}
+		_cullStats.drawCalls += _drawRanges.size();
+		_drawRanges.clear();
+		return;
+	}
+
+	_drawCounts.clear();
+	_drawOffsets.clear();
+	for (const MeshLod &range : _drawRanges) {
+		_drawCounts.push_back(static_cast<GLsizei>(range.indexCount));
+		_drawOffsets.push_back(reinterpret_cast<const void *>(range.firstIndex * sizeof(GLuint)));
+	}
+	glUniform1ui(_uniformLocations.primitiveBase, 0);
+	glMultiDrawElements(GL_TRIANGLES, _drawCounts.data(), GL_UNSIGNED_INT, _drawOffsets.data(),
+		static_cast<GLsizei>(_drawRanges.size()));
+	_cullStats.drawCalls++;
+	_drawRanges.clear();
+}
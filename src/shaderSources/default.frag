@@ -3,16 +3,28 @@ out vec4 FragColor;
 
 in vec2 TexCoord;
 in vec3 VertexColor;
-in vec3 FaceColor;
 
 uniform sampler2D tex;
 uniform float mixValue;  // 0.0 = colors, 1.0 = texture
 uniform bool useFaceColors;  // true = face colors, false = vertex colors
+uniform uint primitiveBase;  // first triangle of the current draw range
+uniform vec3 diffuseColor;  // Kd of the current material, tints the texture
+
+// Vibrant color per triangle, hashed from its index so that welded
+// vertices can be shared between faces
+vec3 faceColor(uint id) {
+    id ^= id >> 16;
+    id *= 0x7feb352dU;
+    id ^= id >> 15;
+    id *= 0x846ca68bU;
+    id ^= id >> 16;
+    return 0.3 + 0.7 * vec3(id & 0xFFU, (id >> 8) & 0xFFU, (id >> 16) & 0xFFU) / 255.0;
+}
 
 void main() {
     vec4 colorFromVertices = vec4(VertexColor, 1.0);
-    vec4 colorFromFaces = vec4(FaceColor, 1.0);
-    vec4 colorFromTexture = texture(tex, TexCoord);
+    vec4 colorFromFaces = vec4(faceColor(primitiveBase + uint(gl_PrimitiveID)), 1.0);
+    vec4 colorFromTexture = texture(tex, TexCoord) * vec4(diffuseColor, 1.0);
 
     vec4 colorSource = useFaceColors ? colorFromFaces : colorFromVertices;
 
@@ -1,20 +1,23 @@
 #version 410 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTex;
-layout (location = 2) in vec3 aColor;
-layout (location = 3) in vec3 aFaceColor;
+// locations are bound by name from VERTEX_SEMANTICS in VertexLayout.hpp
+in vec3 aPos;
+in vec2 aTex;
+in vec3 aColor;
 
 out vec2 TexCoord;
 out vec3 VertexColor;
-out vec3 FaceColor;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
+// maps stored positions back to model space, identity for float vertices
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
 void main() {
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(aPos, 1.0);
+    vec3 position = positionOffset + aPos * positionScale;
+    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
     TexCoord = aTex;
     VertexColor = aColor;
-    FaceColor = aFaceColor;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "ShaderProgram.hpp"
 #include "../ResourcePath.hpp"
+#include "../modelLoader/VertexLayout.hpp"
 #include <exception>
 #include <iostream>
 #include <vector>
@@ -30,6 +31,11 @@ ShaderProgram::ShaderProgram()
 	_shaderProgram = glCreateProgram();
 	glAttachShader(_shaderProgram, vertShader.getShader());
 	glAttachShader(_shaderProgram, fragShader.getShader());
+
+	// vertex inputs get their locations from the vertex layouts, not the shader source
+	for (const VertexSemanticInfo &info : VERTEX_SEMANTICS) {
+		glBindAttribLocation(_shaderProgram, info.semantic, info.name);
+	}
 	glLinkProgram(_shaderProgram);
 
 	GLint isLinked = 0;
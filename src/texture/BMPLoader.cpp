@@ -1,10 +1,10 @@
 #include "BMPLoader.hpp"
 #include "../ResourcePath.hpp"
+#include "../fileMapping/MappedFile.hpp"
 #include <exception>
 #include <string>
-#include <stdio.h>
-#include <vector>
-#include <iostream>
+#include <memory>
+#include <cstring>
 
 using namespace std;
 
@@ -42,26 +42,20 @@ BMPLoader::BMPLoader(const string &path)
 		throw BMPLoaderException(BMPLoaderException::FILE_NOT_FOUND, _path);
 	}
 
-	FILE* file = fopen(ResourcePath::getPath(path).c_str(), "rb");
-	if (!file) {
+	try {
+		_file = make_shared<const MappedFile>(ResourcePath::getPath(path));
+	} catch (const MappedFileException &) {
 		throw BMPLoaderException(BMPLoaderException::CANNOT_OPEN, _path);
 	}
-
-	fread(&_bmpHeader, sizeof(Header), 1, file);
-
-	if (_bmpHeader.signature != 0x4D42) {
-		fclose(file);
+	if (_file->size() < sizeof(Header)) {
 		throw BMPLoaderException(BMPLoaderException::INVALID_FORMAT, _path);
 	}
+	memcpy(&_bmpHeader, _file->data(), sizeof(Header));
 
-	size_t pixelDataSize = _bmpHeader.fileSize - _bmpHeader.dataOffset;
-	_pixelData.resize(pixelDataSize);  // Allocate memory in the vector
-	fseek(file, _bmpHeader.dataOffset, SEEK_SET);
-	fread(_pixelData.data(), 1, pixelDataSize, file);
-	if (_pixelData.empty()) {
+	if (_bmpHeader.signature != 0x4D42 || _bmpHeader.dataOffset < sizeof(Header)
+		|| _bmpHeader.dataOffset >= _file->size()) {
 		throw BMPLoaderException(BMPLoaderException::INVALID_FORMAT, _path);
 	}
-	fclose(file);
 
 	channels = _bmpHeader.bitsPerPixel / 8;
 }
@@ -71,5 +65,17 @@ const Header *BMPLoader::getBMPHeader() const {
 }
 
 const unsigned char *BMPLoader::getPixelData() const {
-	return _pixelData.data();
+	return reinterpret_cast<const unsigned char *>(_file->data()) + _bmpHeader.dataOffset;
+}
+
+size_t BMPLoader::getPixelDataSize() const {
+	return _file->size() - _bmpHeader.dataOffset;
+}
+
+size_t BMPLoader::getPixelDataOffset() const {
+	return _bmpHeader.dataOffset;
+}
+
+const shared_ptr<const MappedFile> &BMPLoader::getFile() const {
+	return _file;
 }
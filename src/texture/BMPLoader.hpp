@@ -1,8 +1,11 @@
 #pragma once
 
+#include "../fileMapping/MappedFile.hpp"
 #include <exception>
 #include <string>
-#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
 
 class BMPLoaderException : public std::exception {
 public:
@@ -43,6 +46,15 @@ struct Header {
 };
 #pragma pack(pop)
 
+/**
+* @class BMPLoader
+* @brief Maps a BMP file and points into its pixel array, nothing is copied.
+*
+* The pixel array runs from `dataOffset` to the end of the file; the
+* `fileSize` field of the header is not trusted. Rows are bottom-up and
+* padded to 4 bytes, as GL_UNPACK_ALIGNMENT expects by default. The
+* mapping outlives the loader when getFile() is kept.
+*/
 class BMPLoader {
 public:
 	int channels = 0;
@@ -51,11 +63,14 @@ public:
 
 	const Header *getBMPHeader() const;
 	const unsigned char *getPixelData() const;
+	size_t getPixelDataSize() const;
+	size_t getPixelDataOffset() const;
+	const std::shared_ptr<const MappedFile> &getFile() const;
 
 private:
 	std::string _path;
 	Header _bmpHeader;
-	std::vector<unsigned char> _pixelData; // BGR
+	std::shared_ptr<const MappedFile> _file;  // pixel array (BGR) at _bmpHeader.dataOffset
 
 	BMPLoader();
 };
@@ -0,0 +1,180 @@
+#include "MipCache.hpp"
+#include "MipChain.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include <string>
+#include <vector>
+#include <optional>
+#include <memory>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <cstring>
+#include <cstddef> // offsetof
+#include <cstdio> // remove()
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <unistd.h> // getpid()
+
+using namespace std;
+
+static const char MAGIC[8] = {'S', 'C', 'O', 'P', 'T', 'E', 'X', '\0'};
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+static_assert(sizeof(MipCacheHeader) <= MipCache::DATA_OFFSET, "cache header overlaps data");
+static_assert(sizeof(MipLevel) == 24, "MipLevel is stored as is");
+
+static const char *CACHE_SUFFIXES[] = {".scoptex", ".bc1.scoptex", ".bc7.scoptex"};  // by TextureCompression
+
+static bool isFormatOf(TextureCompression compression, TextureFormat format) {
+	switch (compression) {
+		case COMPRESSION_NONE: return format == TEXTURE_BGR8 || format == TEXTURE_BGRA8;
+		case COMPRESSION_BC1: return format == TEXTURE_BC1;
+		case COMPRESSION_BC7: return format == TEXTURE_BC7;
+	}
+	return false;
+}
+
+/**
+* @brief Prepares the cache lookup key from the current state of the source.
+*
+* If the source cannot be inspected the cache is never used.
+*/
+MipCache::MipCache(const string &sourcePath, TextureCompression compression)
+	: _path(sourcePath + CACHE_SUFFIXES[compression])
+{
+	memset(&_key, 0, sizeof(_key));
+	memcpy(_key.magic, MAGIC, sizeof(MAGIC));
+	_key.version = VERSION;
+	_key.byteOrder = BYTE_ORDER_MARK;
+	_key.compression = compression;
+
+	error_code ec;
+	uintmax_t size = filesystem::file_size(sourcePath, ec);
+	if (ec) {
+		return;
+	}
+	filesystem::file_time_type time = filesystem::last_write_time(sourcePath, ec);
+	if (ec) {
+		return;
+	}
+
+	_key.sourceSize = size;
+	_key.sourceTime = static_cast<int64_t>(time.time_since_epoch().count());
+	_sourceFound = true;
+}
+
+/**
+* @brief Reads the chain back if the cache exists and matches the source.
+*
+* Every level must have the size the one above it implies and lie inside
+* the pixel bytes, so a damaged file is a miss, never a bad upload. The
+* levels are read in place, the chain keeps the file mapped.
+*/
+optional<MipChain> MipCache::load() const {
+	if (!_sourceFound) {
+		return nullopt;
+	}
+
+	try {
+		MappedFile file(_path);
+		if (file.size() < DATA_OFFSET) {
+			return nullopt;
+		}
+
+		MipCacheHeader header;
+		memcpy(&header, file.data(), sizeof(header));
+
+		// everything up to the image description must match the expected key
+		const size_t keySize = offsetof(MipCacheHeader, format);
+		if (memcmp(&header, &_key, keySize) != 0) {
+			return nullopt;
+		}
+		const TextureFormat format = static_cast<TextureFormat>(header.format);
+		if (!isFormatOf(static_cast<TextureCompression>(header.compression), format) || header.levelCount == 0
+			|| file.size() != DATA_OFFSET + header.levelCount * sizeof(MipLevel) + header.pixelBytes) {
+			return nullopt;
+		}
+
+		vector<MipLevel> levels(header.levelCount);
+		memcpy(levels.data(), file.data() + DATA_OFFSET, levels.size() * sizeof(MipLevel));
+		if (levels[0].width == 0 || levels[0].height == 0
+			|| levels.size() != MipChain::getLevelCount(levels[0].width, levels[0].height)) {
+			return nullopt;
+		}
+		uint64_t offset = 0;
+		for (size_t l = 0; l < levels.size(); l++) {
+			const MipLevel &level = levels[l];
+			if (l > 0 && (level.width != max<uint32_t>(1, levels[l - 1].width / 2)
+				|| level.height != max<uint32_t>(1, levels[l - 1].height / 2))) {
+				return nullopt;
+			}
+			if (level.offset != offset || level.size != MipChain::getLevelBytes(format, level.width, level.height)) {
+				return nullopt;
+			}
+			offset += level.size;
+		}
+		if (offset != header.pixelBytes) {
+			return nullopt;
+		}
+
+		const size_t pixelOffset = DATA_OFFSET + levels.size() * sizeof(MipLevel);
+		return MipChain(format, move(levels), make_shared<const MappedFile>(move(file)), pixelOffset);
+	} catch (const MappedFileException &) {
+		return nullopt;
+	}
+}
+
+/**
+* @brief Writes the cache for the current source state; `chain` must be
+* made with the compression the cache was created for.
+*
+* The file is written under a temporary name and renamed into place, so
+* a concurrent reader never sees a partial cache. Loader threads may
+* store the same image at once, the name is unique per thread.
+*
+* @return false if the cache could not be written (e.g. read-only directory).
+*/
+bool MipCache::store(const MipChain &chain) const {
+	if (!_sourceFound || !isFormatOf(static_cast<TextureCompression>(_key.compression), chain.getFormat())) {
+		return false;
+	}
+
+	MipCacheHeader header = _key;
+	header.format = chain.getFormat();
+	header.levelCount = static_cast<uint32_t>(chain.getLevelCount());
+	header.pixelBytes = chain.getPixelBytes();
+
+	string tmpPath = _path + ".tmp" + to_string(getpid()) + "_" + to_string(hash<thread::id>()(this_thread::get_id()));
+	{
+		ofstream out(tmpPath, ios::binary | ios::trunc);
+		if (!out) {
+			return false;
+		}
+
+		char padding[DATA_OFFSET] = {};
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(padding, DATA_OFFSET - sizeof(header));
+		out.write(reinterpret_cast<const char *>(chain.getLevels().data()), chain.getLevels().size() * sizeof(MipLevel));
+		out.write(reinterpret_cast<const char *>(chain.getPixelData()), chain.getPixelBytes());
+		if (!out) {
+			out.close();
+			remove(tmpPath.c_str());
+			return false;
+		}
+	}
+
+	error_code ec;
+	filesystem::rename(tmpPath, _path, ec);
+	if (ec) {
+		remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+// getters //
+
+const string &MipCache::getPath() const {
+	return _path;
+}
@@ -0,0 +1,59 @@
+/**
+* @file MipCache.hpp
+* @brief Versioned binary cache (.scoptex) of a texture's MipChain.
+*
+* The cache sits next to the source image (`image.bmp.scoptex`, or
+* `image.bmp.bc1.scoptex` and `image.bmp.bc7.scoptex` for compressed
+* levels) and is keyed by the size and modification time of the source,
+* like MeshCache, so an edited image is decoded and filtered again. A hit
+* skips the BMP decode as well as the filtering and the block compression.
+* The `scoptex` tool writes the same files ahead of time.
+*
+* File layout: MipCacheHeader, padding up to DATA_OFFSET, MipLevel table,
+* pixel bytes of all levels as in MipChain::getPixelData().
+*/
+
+#pragma once
+
+#include "MipChain.hpp"
+#include <string>
+#include <optional>
+#include <cstdint>
+
+#pragma pack(push, 1)
+struct MipCacheHeader {
+	char magic[8];             // "SCOPTEX\0"
+	uint32_t version;
+	uint32_t byteOrder;        // 0x01020304 as written by the producing machine
+	uint64_t sourceSize;
+	int64_t sourceTime;        // modification time of the source, file clock ticks
+	uint32_t compression;      // TextureCompression the levels were made with
+	uint32_t format;           // TextureFormat of every level
+	uint32_t levelCount;       // MipLevel entries after the header
+	uint64_t pixelBytes;
+};
+#pragma pack(pop)
+
+/**
+* @class MipCache
+* @brief Looks up and writes the cache file of one source image.
+*/
+class MipCache {
+public:
+	static constexpr uint32_t VERSION = 2;
+	static constexpr size_t DATA_OFFSET = 64;
+
+	MipCache(const std::string &sourcePath, TextureCompression compression);
+
+	std::optional<MipChain> load() const;
+	bool store(const MipChain &chain) const;
+
+	const std::string &getPath() const;
+
+private:
+	std::string _path;
+	MipCacheHeader _key;  // up to `compression`
+	bool _sourceFound = false;
+
+	MipCache();
+};
@@ -0,0 +1,288 @@
+#include "MipChain.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+	#define MIP_KERNELS_X86 1
+	#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/**
+* @brief Level 0 only; `pixels` holds `height` rows of getRowBytes() bytes.
+*/
+MipChain::MipChain(uint32_t width, uint32_t height, uint32_t channels, const unsigned char *pixels)
+	: _format((channels == 4) ? TEXTURE_BGRA8 : TEXTURE_BGR8)
+{
+	const size_t size = getRowBytes(width, channels) * height;
+	_levels.push_back({width, height, 0, size});
+	_pixels.assign(pixels, pixels + size);
+}
+
+/**
+* @brief Takes over levels read back from a cache or encoded, see MipCache
+* and TextureEncoder.
+*/
+MipChain::MipChain(TextureFormat format, vector<MipLevel> levels, vector<unsigned char> pixels)
+	: _format(format), _levels(move(levels)), _pixels(move(pixels))
+{}
+
+/**
+* @brief Reads the levels in place from `file`, starting `fileOffset`
+* bytes in; the caller checked that they fit.
+*/
+MipChain::MipChain(TextureFormat format, vector<MipLevel> levels, shared_ptr<const MappedFile> file, size_t fileOffset)
+	: _format(format), _levels(move(levels)), _file(move(file)), _fileOffset(fileOffset)
+{}
+
+/**
+* @brief Replaces the levels below 0 by box filtered ones, down to 1x1.
+*
+* Each level is built from the one above it, two source rows at a time:
+* MipKernels::sumRows() adds them up, MipKernels::averagePairs() adds
+* horizontal neighbours and rounds. A source dimension of 1 is used for
+* both members of its pairs; an odd one drops its last row or column.
+* Compressed chains are left as they are.
+*/
+void MipChain::buildLevels() {
+	if (isCompressed()) {
+		return;
+	}
+	if (_file) {
+		_pixels.assign(getPixelData(), getPixelData() + _levels[0].size);
+		_file.reset();
+	}
+	const uint32_t channels = getChannels();
+	_levels.resize(1);
+	const size_t levelCount = getLevelCount(_levels[0].width, _levels[0].height);
+	size_t total = _levels[0].size;
+	for (size_t l = 1; l < levelCount; l++) {
+		const MipLevel &above = _levels[l - 1];
+		MipLevel level;
+		level.width = max<uint32_t>(1, above.width / 2);
+		level.height = max<uint32_t>(1, above.height / 2);
+		level.offset = total;
+		level.size = getRowBytes(level.width, channels) * level.height;
+		total += level.size;
+		_levels.push_back(level);
+	}
+	_pixels.resize(total);
+
+	const size_t c = channels;
+	vector<uint16_t> sums;
+	for (size_t l = 1; l < levelCount; l++) {
+		const MipLevel &src = _levels[l - 1];
+		const MipLevel &dst = _levels[l];
+		const size_t srcRow = getRowBytes(src.width, channels);
+		const size_t dstRow = getRowBytes(dst.width, channels);
+		sums.resize(2 * dst.width * c);
+
+		for (size_t y = 0; y < dst.height; y++) {
+			const unsigned char *a = _pixels.data() + src.offset + min<size_t>(2 * y, src.height - 1) * srcRow;
+			const unsigned char *b = _pixels.data() + src.offset + min<size_t>(2 * y + 1, src.height - 1) * srcRow;
+			if (src.width == 1) {
+				MipKernels::sumRows(a, b, c, sums.data());
+				copy(sums.begin(), sums.begin() + c, sums.begin() + c);
+			} else {
+				MipKernels::sumRows(a, b, sums.size(), sums.data());
+			}
+			MipKernels::averagePairs(sums.data(), dst.width, channels, _pixels.data() + dst.offset + y * dstRow);
+		}
+	}
+}
+
+// getters //
+
+TextureFormat MipChain::getFormat() const {
+	return _format;
+}
+
+// bytes per pixel of uncompressed formats, 0 for block compressed ones
+uint32_t MipChain::getChannels() const {
+	return (_format == TEXTURE_BGR8) ? 3 : (_format == TEXTURE_BGRA8) ? 4 : 0;
+}
+
+bool MipChain::isCompressed() const {
+	return _format == TEXTURE_BC1 || _format == TEXTURE_BC7;
+}
+
+size_t MipChain::getLevelCount() const {
+	return _levels.size();
+}
+
+const MipLevel &MipChain::getLevel(size_t level) const {
+	return _levels[level];
+}
+
+const unsigned char *MipChain::getLevelData(size_t level) const {
+	return getPixelData() + _levels[level].offset;
+}
+
+const vector<MipLevel> &MipChain::getLevels() const {
+	return _levels;
+}
+
+// all levels, getPixelBytes() long
+const unsigned char *MipChain::getPixelData() const {
+	if (_file) {
+		return reinterpret_cast<const unsigned char *>(_file->data()) + _fileOffset;
+	}
+	return _pixels.data();
+}
+
+size_t MipChain::getPixelBytes() const {
+	return _levels.empty() ? 0 : _levels.back().offset + _levels.back().size;
+}
+
+bool MipChain::isMapped() const {
+	return _file != nullptr;
+}
+
+size_t MipChain::getRowBytes(uint32_t width, uint32_t channels) {
+	return (static_cast<size_t>(width) * channels + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+}
+
+size_t MipChain::getLevelBytes(TextureFormat format, uint32_t width, uint32_t height) {
+	const size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+	switch (format) {
+		case TEXTURE_BGR8: return getRowBytes(width, 3) * height;
+		case TEXTURE_BGRA8: return getRowBytes(width, 4) * height;
+		case TEXTURE_BC1: return blocks * 8;
+		case TEXTURE_BC7: return blocks * 16;
+	}
+	return 0;
+}
+
+// levels of a full chain: 1 + floor(log2(largest dimension))
+size_t MipChain::getLevelCount(uint32_t width, uint32_t height) {
+	size_t count = 1;
+	for (uint32_t size = max(width, height); size > 1; size /= 2) {
+		count++;
+	}
+	return count;
+}
+
+// kernels //
+
+/**
+* The vector kernels add in 16 bits, where four bytes cannot overflow,
+* and round with the same (sum + 2) >> 2 as the scalar ones, so every
+* instruction set produces the same levels. Tails go to the scalar loops.
+*/
+
+static void sumRowsScalar(const unsigned char *a, const unsigned char *b, size_t count, uint16_t *sums) {
+	for (size_t i = 0; i < count; i++) {
+		sums[i] = static_cast<uint16_t>(a[i] + b[i]);
+	}
+}
+
+static void averagePairsScalar(const uint16_t *sums, size_t width, uint32_t channels, unsigned char *out) {
+	for (size_t x = 0; x < width; x++) {
+		const uint16_t *left = sums + 2 * x * channels;
+		for (uint32_t k = 0; k < channels; k++) {
+			out[x * channels + k] = static_cast<unsigned char>((left[k] + left[channels + k] + 2) >> 2);
+		}
+	}
+}
+
+#ifdef MIP_KERNELS_X86
+
+static void sumRowsSSE2(const unsigned char *a, const unsigned char *b, size_t count, uint16_t *sums) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sums + i),
+			_mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sums + i + 8),
+			_mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero)));
+	}
+	sumRowsScalar(a + i, b + i, count - i, sums + i);
+}
+
+__attribute__((target("avx2")))
+static void sumRowsAVX2(const unsigned char *a, const unsigned char *b, size_t count, uint16_t *sums) {
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		for (size_t half = 0; half < 32; half += 16) {
+			__m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + half)));
+			__m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + half)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(sums + i + half), _mm256_add_epi16(va, vb));
+		}
+	}
+	sumRowsScalar(a + i, b + i, count - i, sums + i);
+}
+
+/**
+* Adds every sum to the one a pixel to its right, rounds 16 results into
+* bytes and keeps those that start a pair with one shuffle: BGR keeps
+* three pixels of every 18 sums, BGRA two of every 16. The 16 byte store
+* stays inside the output row; the bytes past the kept ones are written
+* again by the next step.
+*/
+__attribute__((target("ssse3")))
+static void averagePairsSSSE3(const uint16_t *sums, size_t width, uint32_t channels, unsigned char *out) {
+	const size_t inputStep = (channels == 3) ? 18 : 16;
+	const __m128i keep = (channels == 3)
+		? _mm_setr_epi8(0, 1, 2, 6, 7, 8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1)
+		: _mm_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i two = _mm_set1_epi16(2);
+	const size_t outCount = width * channels;
+	const size_t sumCount = outCount * 2;
+
+	size_t i = 0, j = 0;
+	for (; i + channels + 16 <= sumCount && j + 16 <= outCount; i += inputStep, j += inputStep / 2) {
+		__m128i low = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(sums + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(sums + i + channels)));
+		__m128i high = _mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(sums + i + 8)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(sums + i + 8 + channels)));
+		low = _mm_srli_epi16(_mm_add_epi16(low, two), 2);
+		high = _mm_srli_epi16(_mm_add_epi16(high, two), 2);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + j), _mm_shuffle_epi8(_mm_packus_epi16(low, high), keep));
+	}
+	averagePairsScalar(sums + i, (outCount - j) / channels, channels, out + j);
+}
+
+#endif
+
+struct MipKernelTable {
+	void (*sumRows)(const unsigned char *, const unsigned char *, size_t, uint16_t *);
+	void (*averagePairs)(const uint16_t *, size_t, uint32_t, unsigned char *);
+	const char *name;
+};
+
+// resolved once, on first use
+static const MipKernelTable &getKernels() {
+	static const MipKernelTable table = []() -> MipKernelTable {
+#ifdef MIP_KERNELS_X86
+		if (__builtin_cpu_supports("avx2")) {
+			return {sumRowsAVX2, averagePairsSSSE3, "AVX2"};
+		}
+		if (__builtin_cpu_supports("ssse3")) {
+			return {sumRowsSSE2, averagePairsSSSE3, "SSSE3"};
+		}
+#endif
+		return {sumRowsScalar, averagePairsScalar, "scalar"};
+	}();
+	return table;
+}
+
+void MipKernels::sumRows(const unsigned char *a, const unsigned char *b, size_t count, uint16_t *sums) {
+	getKernels().sumRows(a, b, count, sums);
+}
+
+void MipKernels::averagePairs(const uint16_t *sums, size_t width, uint32_t channels, unsigned char *out) {
+	getKernels().averagePairs(sums, width, channels, out);
+}
+
+const char *MipKernels::getInstructionSet() {
+	return getKernels().name;
+}
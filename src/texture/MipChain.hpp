@@ -0,0 +1,123 @@
+/**
+* @file MipChain.hpp
+* @brief A texture image with its mipmap levels, built on the CPU.
+*
+* Every level halves the one above it (rounded down, at least 1) with a
+* 2x2 box filter on the BGR or BGRA bytes, down to 1x1. The filter
+* kernels in MipKernels pick AVX2 or SSSE3 at run time when the CPU has
+* them and fall back to scalar loops elsewhere; all give the same bytes.
+* Filtered chains can be block compressed with TextureEncoder.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile;
+
+/**
+* @brief Where the levels below 0 come from.
+*/
+enum MipmapMode {
+	MIPMAP_GPU,  // level 0 only, glGenerateMipmap() after the upload
+	MIPMAP_CPU,  // MipChain::buildLevels(), cached on disk (MipCache)
+};
+
+/**
+* @brief Block compression a texture is asked for, see TextureEncoder.
+*/
+enum TextureCompression {
+	COMPRESSION_NONE,
+	COMPRESSION_BC1,
+	COMPRESSION_BC7,
+};
+
+/**
+* @brief Pixel layout of every level of a MipChain.
+*/
+enum TextureFormat {
+	TEXTURE_BGR8,
+	TEXTURE_BGRA8,
+	TEXTURE_BC1,  // 8 bytes per 4x4 block, RGB
+	TEXTURE_BC7,  // 16 bytes per 4x4 block, RGBA
+};
+
+/**
+* @struct MipLevel
+* @brief Size and position of one level in MipChain::getPixelData().
+*/
+struct MipLevel {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+/**
+* @class MipChain
+* @brief Levels of one image in a single buffer, as glTexImage2D() takes
+* them: rows bottom-up, each padded to ROW_ALIGNMENT bytes. Compressed
+* levels are rows of 4x4 blocks, bottom-up as well.
+*
+* The buffer is either owned or a region of a mapped file (the pixel
+* array of a BMP, the levels of a MipCache file) that the chain keeps
+* mapped, so loading never copies the pixels to the heap; copies of the
+* chain share the mapping. buildLevels() moves level 0 to the heap first.
+*/
+class MipChain {
+public:
+	static constexpr size_t ROW_ALIGNMENT = 4;  // GL_UNPACK_ALIGNMENT default, and BMP row padding
+
+	MipChain(uint32_t width, uint32_t height, uint32_t channels, const unsigned char *pixels);
+	MipChain(TextureFormat format, std::vector<MipLevel> levels, std::vector<unsigned char> pixels);
+	MipChain(TextureFormat format, std::vector<MipLevel> levels, std::shared_ptr<const MappedFile> file,
+		size_t fileOffset);
+
+	void buildLevels();
+
+	TextureFormat getFormat() const;
+	uint32_t getChannels() const;
+	bool isCompressed() const;
+	size_t getLevelCount() const;
+	const MipLevel &getLevel(size_t level) const;
+	const unsigned char *getLevelData(size_t level) const;
+	const std::vector<MipLevel> &getLevels() const;
+	const unsigned char *getPixelData() const;
+	size_t getPixelBytes() const;
+	bool isMapped() const;
+
+	static size_t getRowBytes(uint32_t width, uint32_t channels);
+	static size_t getLevelBytes(TextureFormat format, uint32_t width, uint32_t height);
+	static size_t getLevelCount(uint32_t width, uint32_t height);
+
+private:
+	TextureFormat _format;
+	std::vector<MipLevel> _levels;
+	std::vector<unsigned char> _pixels;
+	std::shared_ptr<const MappedFile> _file;  // when set, the levels start at _fileOffset in it
+	size_t _fileOffset = 0;
+
+	MipChain();
+};
+
+namespace MipKernels {
+	/**
+	* @brief sums[i] = a[i] + b[i] for i in [0, count).
+	*/
+	void sumRows(const unsigned char *a, const unsigned char *b, size_t count, uint16_t *sums);
+
+	/**
+	* @brief Averages horizontal pixel pairs of two summed rows:
+	* out[x * c + k] = (sums[2x * c + k] + sums[(2x + 1) * c + k] + 2) / 4
+	* for x in [0, width), with c = `channels` (3 or 4).
+	*/
+	void averagePairs(const uint16_t *sums, size_t width, uint32_t channels, unsigned char *out);
+
+	/**
+	* @return "AVX2", "SSSE3" or "scalar", the kernels this CPU runs.
+	*/
+	const char *getInstructionSet();
+}
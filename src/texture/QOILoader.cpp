@@ -0,0 +1,290 @@
+#include "QOILoader.hpp"
+#include "MipChain.hpp"
+#include "../ResourcePath.hpp"
+#include "../fileMapping/MappedFile.hpp"
+#include <exception>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+static const char MAGIC[4] = {'q', 'o', 'i', 'f'};
+static const size_t HEADER_SIZE = 14;
+static const unsigned char END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+static const uint64_t MAX_PIXELS = 400000000;  // limit of the reference implementation
+
+static const uint8_t OP_INDEX = 0x00;  // 00xxxxxx: index into the color table
+static const uint8_t OP_DIFF = 0x40;   // 01rrggbb: small difference to the previous pixel
+static const uint8_t OP_LUMA = 0x80;   // 10gggggg rrrrbbbb: green difference, red and blue relative to it
+static const uint8_t OP_RUN = 0xC0;    // 11xxxxxx: previous pixel repeated 1 to 62 times
+static const uint8_t OP_RGB = 0xFE;
+static const uint8_t OP_RGBA = 0xFF;
+static const uint8_t OP_MASK = 0xC0;
+static const int MAX_RUN = 62;
+static const ptrdiff_t MAX_OP_BYTES = 5;
+
+struct QOIPixel {
+	uint8_t r, g, b, a;
+
+	bool operator==(const QOIPixel &other) const {
+		return r == other.r && g == other.g && b == other.b && a == other.a;
+	}
+};
+
+static size_t getIndexPosition(const QOIPixel &p) {
+	return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+// bytes of the op starting with `op`
+static ptrdiff_t getOpBytes(uint8_t op) {
+	if (op == OP_RGB || op == OP_RGBA) {
+		return (op == OP_RGB) ? 4 : 5;
+	}
+	return ((op & OP_MASK) == OP_LUMA) ? 2 : 1;
+}
+
+static uint32_t readBigEndian(const unsigned char *p) {
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static void writeBigEndian(unsigned char *p, uint32_t value) {
+	p[0] = static_cast<unsigned char>(value >> 24);
+	p[1] = static_cast<unsigned char>(value >> 16);
+	p[2] = static_cast<unsigned char>(value >> 8);
+	p[3] = static_cast<unsigned char>(value);
+}
+
+QOILoaderException::QOILoaderException(ErrorCode err, const string &path)
+	: _errorCode(err), _path(path)
+{
+	if (_path.empty()) {
+		_path = "no path given";
+	}
+
+	switch(_errorCode) {
+		case FILE_NOT_FOUND:
+			_returnMessage = "QOI image not found: " + _path;
+			break;
+		case CANNOT_OPEN:
+			_returnMessage = "QOI image cannot be opened: " + _path;
+			break;
+		case INVALID_FORMAT:
+			_returnMessage = "Invalid QOI image: " + _path;
+			break;
+		default:
+			_returnMessage = "An unknown error occurred during QOI image loading: " + _path;
+			break;
+	}
+}
+
+const char *QOILoaderException::what() const noexcept {
+	return _returnMessage.c_str();
+}
+
+/**
+* @brief Runs the QOI ops from `p` to `end` into bottom-up BGR(A) rows.
+* The channel count is a template argument so the pixel store unrolls.
+* @return false if the ops end before the image does.
+*/
+template <uint32_t Channels>
+static bool decodeOps(const unsigned char *p, const unsigned char *end, uint32_t width, uint32_t height,
+	unsigned char *pixels)
+{
+	const size_t rowBytes = MipChain::getRowBytes(width, Channels);
+	QOIPixel index[64] = {};
+	QOIPixel px = {0, 0, 0, 255};
+	int run = 0;
+
+	for (uint32_t y = 0; y < height; y++) {
+		unsigned char *out = pixels + (height - 1 - y) * rowBytes;
+		for (uint32_t x = 0; x < width; x++, out += Channels) {
+			if (run > 0) {
+				run--;
+			} else {
+				// only the last few ops can run past the end
+				if (end - p < MAX_OP_BYTES && (p >= end || end - p < getOpBytes(*p))) {
+					return false;
+				}
+				const uint8_t op = *p++;
+				if (op == OP_RGB) {
+					px.r = p[0];
+					px.g = p[1];
+					px.b = p[2];
+					p += 3;
+				} else if (op == OP_RGBA) {
+					px.r = p[0];
+					px.g = p[1];
+					px.b = p[2];
+					px.a = p[3];
+					p += 4;
+				} else if ((op & OP_MASK) == OP_INDEX) {
+					px = index[op];
+				} else if ((op & OP_MASK) == OP_DIFF) {
+					px.r = static_cast<uint8_t>(px.r + ((op >> 4) & 3) - 2);
+					px.g = static_cast<uint8_t>(px.g + ((op >> 2) & 3) - 2);
+					px.b = static_cast<uint8_t>(px.b + (op & 3) - 2);
+				} else if ((op & OP_MASK) == OP_LUMA) {
+					const int dg = (op & 0x3F) - 32;
+					const uint8_t rb = *p++;
+					px.r = static_cast<uint8_t>(px.r + dg - 8 + (rb >> 4));
+					px.g = static_cast<uint8_t>(px.g + dg);
+					px.b = static_cast<uint8_t>(px.b + dg - 8 + (rb & 0x0F));
+				} else {
+					run = op & 0x3F;
+				}
+				index[getIndexPosition(px)] = px;
+			}
+
+			out[0] = px.b;
+			out[1] = px.g;
+			out[2] = px.r;
+			if (Channels == 4) {
+				out[3] = px.a;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+* @brief Checks the header of `data` and decodes the image it describes.
+*/
+static MipChain decodeQOI(const unsigned char *data, size_t size, const string &path) {
+	if (size < HEADER_SIZE + sizeof(END_MARKER) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+		throw QOILoaderException(QOILoaderException::INVALID_FORMAT, path);
+	}
+	const uint32_t width = readBigEndian(data + 4);
+	const uint32_t height = readBigEndian(data + 8);
+	const uint32_t channels = data[12];
+	if (width == 0 || height == 0 || (channels != 3 && channels != 4) || data[13] > 1
+		|| uint64_t(width) * height > MAX_PIXELS) {
+		throw QOILoaderException(QOILoaderException::INVALID_FORMAT, path);
+	}
+
+	vector<unsigned char> pixels(MipChain::getRowBytes(width, channels) * height);
+	const unsigned char *ops = data + HEADER_SIZE;
+	const unsigned char *end = data + size - sizeof(END_MARKER);
+	const bool complete = (channels == 4)
+		? decodeOps<4>(ops, end, width, height, pixels.data())
+		: decodeOps<3>(ops, end, width, height, pixels.data());
+	if (!complete) {
+		throw QOILoaderException(QOILoaderException::INVALID_FORMAT, path);
+	}
+
+	const TextureFormat format = (channels == 4) ? TEXTURE_BGRA8 : TEXTURE_BGR8;
+	const MipLevel base = {width, height, 0, pixels.size()};
+	return MipChain(format, {base}, move(pixels));
+}
+
+static MipChain decodeFile(const string &path) {
+	if (path.empty()) {
+		throw QOILoaderException(QOILoaderException::FILE_NOT_FOUND, path);
+	}
+	try {
+		MappedFile file(ResourcePath::getPath(path));
+		return decodeQOI(reinterpret_cast<const unsigned char *>(file.data()), file.size(), path);
+	} catch (const MappedFileException &) {
+		throw QOILoaderException(QOILoaderException::CANNOT_OPEN, path);
+	}
+}
+
+QOILoader::QOILoader(const string &path)
+	: _path(path), _image(decodeFile(path))
+{}
+
+/**
+* @brief Hands out the decoded image; the loader is empty afterwards.
+*/
+MipChain QOILoader::takeImage() {
+	return move(_image);
+}
+
+/**
+* @brief True if the file at `path` starts with the QOI magic.
+*/
+bool QOILoader::isQOIFile(const string &path) {
+	ifstream file(ResourcePath::getPath(path), ios::binary);
+	char magic[sizeof(MAGIC)] = {};
+	return file.read(magic, sizeof(magic)) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+/**
+* @brief Encodes level 0 of `image`, rows top-down as QOI wants them.
+*
+* Each pixel becomes the shortest op that reproduces it: a run of the
+* previous pixel, a hit in the 64 entry color table, a small difference,
+* or the literal color.
+*/
+vector<unsigned char> QOIEncoder::encode(const MipChain &image) {
+	if (image.isCompressed()) {
+		throw QOILoaderException(QOILoaderException::INVALID_FORMAT, "block-compressed texture");
+	}
+	const MipLevel &level = image.getLevel(0);
+	const uint32_t channels = image.getChannels();
+	const size_t rowBytes = MipChain::getRowBytes(level.width, channels);
+
+	vector<unsigned char> out(HEADER_SIZE);
+	out.reserve(HEADER_SIZE + size_t(level.width) * level.height * (channels + 1) + sizeof(END_MARKER));
+	memcpy(out.data(), MAGIC, sizeof(MAGIC));
+	writeBigEndian(out.data() + 4, level.width);
+	writeBigEndian(out.data() + 8, level.height);
+	out[12] = static_cast<unsigned char>(channels);
+	out[13] = 0;  // sRGB with linear alpha
+
+	QOIPixel index[64] = {};
+	QOIPixel previous = {0, 0, 0, 255};
+	int run = 0;
+
+	for (uint32_t y = 0; y < level.height; y++) {
+		const unsigned char *row = image.getLevelData(0) + (level.height - 1 - y) * rowBytes;
+		for (uint32_t x = 0; x < level.width; x++) {
+			const unsigned char *in = row + x * channels;
+			const QOIPixel px = {in[2], in[1], in[0], static_cast<uint8_t>((channels == 4) ? in[3] : 255)};
+
+			if (px == previous) {
+				if (++run == MAX_RUN) {
+					out.push_back(static_cast<unsigned char>(OP_RUN | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				out.push_back(static_cast<unsigned char>(OP_RUN | (run - 1)));
+				run = 0;
+			}
+
+			const size_t position = getIndexPosition(px);
+			if (index[position] == px) {
+				out.push_back(static_cast<unsigned char>(OP_INDEX | position));
+			} else if (px.a == previous.a) {
+				index[position] = px;
+				const int dr = static_cast<int8_t>(px.r - previous.r);
+				const int dg = static_cast<int8_t>(px.g - previous.g);
+				const int db = static_cast<int8_t>(px.b - previous.b);
+				const int drg = dr - dg, dbg = db - dg;
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					out.push_back(static_cast<unsigned char>(OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+				} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+					out.push_back(static_cast<unsigned char>(OP_LUMA | (dg + 32)));
+					out.push_back(static_cast<unsigned char>((drg + 8) << 4 | (dbg + 8)));
+				} else {
+					out.insert(out.end(), {OP_RGB, px.r, px.g, px.b});
+				}
+			} else {
+				index[position] = px;
+				out.insert(out.end(), {OP_RGBA, px.r, px.g, px.b, px.a});
+			}
+			previous = px;
+		}
+	}
+	if (run > 0) {
+		out.push_back(static_cast<unsigned char>(OP_RUN | (run - 1)));
+	}
+	out.insert(out.end(), END_MARKER, END_MARKER + sizeof(END_MARKER));
+	return out;
+}
@@ -0,0 +1,68 @@
+/**
+* @file QOILoader.hpp
+* @brief Decoder and encoder for QOI ("Quite OK Image") files.
+*
+* QOI is lossless like the BMPs the textures come in, but compresses runs,
+* small color differences and recently seen colors, so the files are
+* usually several times smaller and decode at memory speed. TextureImage
+* picks the loader by the magic bytes of a file, so any texture path may
+* name either format.
+*
+* See https://qoiformat.org/qoi-specification.pdf for the format.
+*/
+
+#pragma once
+
+#include "MipChain.hpp"
+#include <exception>
+#include <string>
+#include <vector>
+
+class QOILoaderException : public std::exception {
+public:
+	enum ErrorCode {
+		FILE_NOT_FOUND,
+		CANNOT_OPEN,
+		INVALID_FORMAT,
+	};
+
+	explicit QOILoaderException(ErrorCode err, const std::string &path);
+	const char *what() const noexcept override;
+
+private:
+	ErrorCode _errorCode;
+	std::string _path;
+	std::string _returnMessage;
+};
+
+/**
+* @class QOILoader
+* @brief Decodes a QOI file into level 0 of a MipChain.
+*
+* QOI stores rows top-down as RGB(A); the image is turned into the layout
+* of a BMP (bottom-up BGR or BGRA rows padded to MipChain::ROW_ALIGNMENT),
+* so both loaders give the same bytes and TextureImage hashes for one
+* picture. Truncated or corrupt data is rejected, never read past.
+*/
+class QOILoader {
+public:
+	explicit QOILoader(const std::string &path);
+
+	MipChain takeImage();
+
+	static bool isQOIFile(const std::string &path);
+
+private:
+	std::string _path;
+	MipChain _image;
+
+	QOILoader();
+};
+
+namespace QOIEncoder {
+	/**
+	* @brief The QOI file of level 0 of `image`, which must be uncompressed.
+	* @throws QOILoaderException for block-compressed chains.
+	*/
+	std::vector<unsigned char> encode(const MipChain &image);
+}
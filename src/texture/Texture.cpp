@@ -1,37 +1,182 @@
 #include "Texture.hpp"
-#include "BMPLoader.hpp"
+#include "MipChain.hpp"
+#include "TextureEncoder.hpp"
 #include <glad/gl.h>
 #include <exception>
 #include <string>
-#include <sstream>
-#include <fstream>
 #include <vector>
+#include <algorithm>
 #include <iostream>
-#include <filesystem>
+#include <cstdint>
+#include <optional>
 
 using namespace std;
 
-Texture::Texture(const string &path) :
-	_bmpImage(path)
+// not in the 4.1 core headers: S3TC is an extension, BPTC core from 4.2 on
+static const GLenum COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+static const GLenum COMPRESSED_RGBA_BPTC_UNORM = 0x8E8C;
+
+static GLenum getCompressedFormat(TextureFormat format) {
+	return (format == TEXTURE_BC1) ? COMPRESSED_RGB_S3TC_DXT1 : COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+// whether the driver lists `format` among the compressed formats it takes
+static bool isCompressedFormatSupported(GLenum format) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+	vector<GLint> formats(max(count, 0));
+	if (count > 0) {
+		glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+	}
+	return find(formats.begin(), formats.end(), static_cast<GLint>(format)) != formats.end();
+}
+
+/**
+* @brief Uploads every level of `mips` and samples them trilinearly.
+*
+* A chain with fewer levels than its size allows (MIPMAP_GPU) gets the
+* rest from glGenerateMipmap(). Compressed levels go up as they are when
+* the driver takes their format, otherwise they are decoded to BGRA
+* first (BPTC needs GL 4.2, S3TC an extension), with a warning.
+*/
+Texture::Texture(const MipChain &mips)
+	: Texture(allocate(mips))
 {
-	glGenTextures(1, &_textureID);
-	glBindTexture(GL_TEXTURE_2D, _textureID);
+	while (!uploadChunk(mips, SIZE_MAX)) {}
+}
 
-	GLenum formatBMPImage =(_bmpImage.channels == 4) ? GL_BGRA : GL_BGR;
+/**
+* @brief Creates the texture with storage for every level of `mips`,
+* filled later by uploadChunk().
+*/
+Texture Texture::allocate(const MipChain &mips) {
+	Texture texture;
+	glGenTextures(1, &texture._textureID);
+	glBindTexture(GL_TEXTURE_2D, texture._textureID);
 
-	glTexImage2D(
-		GL_TEXTURE_2D, 0, GL_RGB,
-		_bmpImage.getBMPHeader()->width,
-		_bmpImage.getBMPHeader()->height,
-		0, formatBMPImage, GL_UNSIGNED_BYTE,
-		_bmpImage.getPixelData());
+	if (mips.isCompressed() && !isCompressedFormatSupported(getCompressedFormat(mips.getFormat()))) {
+		static bool warned = false;
+		if (!warned) {
+			cerr << "Compressed texture format not supported by the driver, decoding on the CPU" << endl;
+			warned = true;
+		}
+		texture._decoded = TextureEncoder::decode(mips);
+	}
+	const MipChain &source = texture._decoded ? *texture._decoded : mips;
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	const MipLevel &base = source.getLevel(0);
+	const size_t fullLevels = MipChain::getLevelCount(base.width, base.height);
+	texture._levelCount = source.getLevelCount();
+	texture._generateMipmaps = texture._levelCount < fullLevels;
+
+	// no unpack buffer is bound here, so the storage is left undefined
+	for (size_t l = 0; l < source.getLevelCount(); l++) {
+		const MipLevel &level = source.getLevel(l);
+		if (source.isCompressed()) {
+			glCompressedTexImage2D(
+				GL_TEXTURE_2D, static_cast<GLint>(l), getCompressedFormat(source.getFormat()),
+				static_cast<GLsizei>(level.width),
+				static_cast<GLsizei>(level.height),
+				0, static_cast<GLsizei>(level.size),
+				nullptr);
+		} else {
+			glTexImage2D(
+				GL_TEXTURE_2D, static_cast<GLint>(l), GL_RGB,
+				static_cast<GLsizei>(level.width),
+				static_cast<GLsizei>(level.height),
+				0, (source.getChannels() == 4) ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE,
+				nullptr);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(fullLevels - 1));
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT) ;
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT) ;
 
 	glActiveTexture(GL_TEXTURE0);
+	return texture;
+}
+
+/**
+* @brief Uploads the next band of rows of the current level, about
+* `maxBytes` but at least one row (one row of blocks when compressed).
+*
+* The band goes through a pixel unpack buffer filled straight from the
+* chain's buffer, which is usually a mapped file; no client-side copy is
+* made and the driver may transfer asynchronously. `mips` must be the
+* chain the texture was allocated for.
+*
+* @return true once every level is up, see isComplete().
+*/
+bool Texture::uploadChunk(const MipChain &mips, size_t maxBytes) {
+	if (isComplete()) {
+		return true;
+	}
+
+	const MipChain &source = _decoded ? *_decoded : mips;
+	const MipLevel &level = source.getLevel(_level);
+	const uint32_t unitRows = source.isCompressed() ? 4 : 1;
+	const size_t unitBytes = MipChain::getLevelBytes(source.getFormat(), level.width, unitRows);
+	const size_t units = max<size_t>(1, maxBytes / unitBytes);
+	const uint32_t rows = static_cast<uint32_t>(min<size_t>(level.height - _row, units * unitRows));
+	const size_t offset = level.offset + _row / unitRows * unitBytes;
+	const size_t bytes = MipChain::getLevelBytes(source.getFormat(), level.width, rows);
+
+	glBindTexture(GL_TEXTURE_2D, _textureID);
+	if (_unpackBuffer == 0) {
+		glGenBuffers(1, &_unpackBuffer);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _unpackBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), source.getPixelData() + offset, GL_STREAM_DRAW);
+
+	// rows are padded like BMP rows, which 24-bit widths that are not a multiple of 4 need
+	glPixelStorei(GL_UNPACK_ALIGNMENT, static_cast<GLint>(MipChain::ROW_ALIGNMENT));
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	if (source.isCompressed()) {
+		glCompressedTexSubImage2D(
+			GL_TEXTURE_2D, static_cast<GLint>(_level), 0, static_cast<GLint>(_row),
+			static_cast<GLsizei>(level.width), static_cast<GLsizei>(rows),
+			getCompressedFormat(source.getFormat()), static_cast<GLsizei>(bytes),
+			nullptr);
+	} else {
+		glTexSubImage2D(
+			GL_TEXTURE_2D, static_cast<GLint>(_level), 0, static_cast<GLint>(_row),
+			static_cast<GLsizei>(level.width), static_cast<GLsizei>(rows),
+			(source.getChannels() == 4) ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE,
+			nullptr);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	_row += rows;
+	if (_row == level.height) {
+		_row = 0;
+		_level++;
+	}
+	if (!isComplete()) {
+		return false;
+	}
+
+	// the driver keeps the storage until the transfer is done
+	glDeleteBuffers(1, &_unpackBuffer);
+	_unpackBuffer = 0;
+	if (_generateMipmaps) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	_decoded.reset();
+	return true;
+}
+
+bool Texture::isComplete() const {
+	return _level == _levelCount;
+}
+
+// getters //
+
+GLuint Texture::getTextureID() const {
+	return _textureID;
 }
 
 // other
@@ -39,3 +184,12 @@ Texture::Texture(const string &path) :
 void Texture::unbindTexture() {
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+void Texture::deleteTexture() {
+	glDeleteTextures(1, &_textureID);
+	_textureID = 0;
+	if (_unpackBuffer != 0) {
+		glDeleteBuffers(1, &_unpackBuffer);
+		_unpackBuffer = 0;
+	}
+}
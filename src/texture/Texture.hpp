@@ -1,19 +1,42 @@
 #pragma once
 
-#include "BMPLoader.hpp"
+#include "MipChain.hpp"
 #include <exception>
 #include <glad/gl.h>
 #include <string>
+#include <optional>
+#include <cstddef>
 
+/**
+* @class Texture
+* @brief A mipmapped 2D texture object; the image is not kept once it is uploaded.
+*
+* The levels go up either all at once (constructor) or in bands of rows
+* (allocate(), then uploadChunk() until it returns true), so a large
+* chain can be spread over several frames. A texture is only sampled
+* correctly once isComplete().
+*/
 class Texture {
 public:
-	explicit Texture(const std::string &path);
+	explicit Texture(const MipChain &mips);
+
+	static Texture allocate(const MipChain &mips);
+	bool uploadChunk(const MipChain &mips, size_t maxBytes);
+	bool isComplete() const;
+
+	GLuint getTextureID() const;
 
 	void unbindTexture();
+	void deleteTexture();
 
 private:
-	BMPLoader _bmpImage;
-	GLuint _textureID;
+	GLuint _textureID = 0;
+	GLuint _unpackBuffer = 0;              // while levels are going up
+	size_t _levelCount = 0;                // levels to upload
+	size_t _level = 0;                     // next level to upload
+	uint32_t _row = 0;                     // next row of it, from the bottom
+	bool _generateMipmaps = false;         // once the levels are up
+	std::optional<MipChain> _decoded;      // uploaded instead when the driver lacks the compressed format
 
-	Texture();
+	Texture() = default;
 };
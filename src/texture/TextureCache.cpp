@@ -0,0 +1,94 @@
+#include "TextureCache.hpp"
+#include "Texture.hpp"
+#include "TextureImage.hpp"
+#include "MipChain.hpp"
+#include <glad/gl.h>
+#include <unordered_map>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/**
+* @brief The texture holding the contents of `image`, uploaded on first use.
+*
+* A texture that continueUpload() left half uploaded is finished here.
+*/
+GLuint TextureCache::getTexture(const TextureImage &image) {
+	auto it = _textures.find(image.contentHash);
+	if (it == _textures.end()) {
+		it = _textures.emplace(image.contentHash, Texture(image.mips)).first;
+	}
+	while (!it->second.uploadChunk(image.mips, SIZE_MAX)) {}
+	return it->second.getTextureID();
+}
+
+/**
+* @brief A 1x1 white texture, for materials that only have a Kd color.
+*/
+GLuint TextureCache::getWhiteTexture() {
+	if (!_white) {
+		const unsigned char white[4] = {255, 255, 255, 255};
+		_white.emplace(MipChain(1, 1, 4, white));
+	}
+	return _white->getTextureID();
+}
+
+/**
+* @brief Uploads chunks of the textures of `images` that are not resident
+* yet until `budgetSeconds` passed.
+*
+* At least one chunk of UPLOAD_CHUNK_BYTES goes up per call. Progress is
+* kept in the textures, so the same images are passed again next frame.
+*
+* @return true when every texture of `images` is complete; getTexture()
+* then returns them without uploading anything.
+*/
+bool TextureCache::continueUpload(span<const TextureImage> images, double budgetSeconds) {
+	const auto start = chrono::steady_clock::now();
+	for (const TextureImage &image : images) {
+		auto it = _textures.find(image.contentHash);
+		if (it == _textures.end()) {
+			it = _textures.emplace(image.contentHash, Texture::allocate(image.mips)).first;
+		}
+		while (!it->second.uploadChunk(image.mips, UPLOAD_CHUNK_BYTES)) {
+			if (chrono::duration<double>(chrono::steady_clock::now() - start).count() >= budgetSeconds) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+* @brief Deletes every texture whose image is not among `contentHashes`,
+* complete or not. The white texture stays.
+*/
+void TextureCache::releaseUnused(const vector<size_t> &contentHashes) {
+	for (auto it = _textures.begin(); it != _textures.end();) {
+		if (find(contentHashes.begin(), contentHashes.end(), it->first) != contentHashes.end()) {
+			++it;
+			continue;
+		}
+		it->second.deleteTexture();
+		it = _textures.erase(it);
+	}
+}
+
+size_t TextureCache::getTextureCount() const {
+	return _textures.size() + (_white ? 1 : 0);
+}
+
+void TextureCache::cleanUp() {
+	for (auto &[hash, texture] : _textures) {
+		texture.deleteTexture();
+	}
+	_textures.clear();
+	if (_white) {
+		_white->deleteTexture();
+		_white.reset();
+	}
+}
@@ -0,0 +1,49 @@
+/**
+* @file TextureCache.hpp
+* @brief GL textures shared by every material that shows the same image.
+*/
+
+#pragma once
+
+#include "Texture.hpp"
+#include "TextureImage.hpp"
+#include <glad/gl.h>
+#include <unordered_map>
+#include <optional>
+#include <vector>
+#include <span>
+#include <cstddef>
+
+/**
+* @class TextureCache
+* @brief Content-addressed store of uploaded textures.
+*
+* Textures are keyed by TextureImage::contentHash: an image whose
+* contents are already resident is not uploaded again, whatever its file
+* name. Reloads of a model therefore only upload the images that changed,
+* and continueUpload() spreads those over several frames. Textures live
+* until releaseUnused() drops them or cleanUp(), both need the GL context.
+*/
+class TextureCache {
+public:
+	static constexpr double UPLOAD_FRAME_SECONDS = 0.004;  // upload time a frame may spend
+
+	TextureCache() = default;
+
+	TextureCache(const TextureCache &other) = delete;
+	TextureCache &operator=(const TextureCache &other) = delete;
+
+	GLuint getTexture(const TextureImage &image);
+	GLuint getWhiteTexture();
+	bool continueUpload(std::span<const TextureImage> images, double budgetSeconds = UPLOAD_FRAME_SECONDS);
+	void releaseUnused(const std::vector<size_t> &contentHashes);
+	size_t getTextureCount() const;
+
+	void cleanUp();
+
+private:
+	std::unordered_map<size_t, Texture> _textures;
+	std::optional<Texture> _white;
+
+	static constexpr size_t UPLOAD_CHUNK_BYTES = 1 << 20;
+};
@@ -0,0 +1,586 @@
+#include "TextureEncoder.hpp"
+#include "MipChain.hpp"
+#include "../jobs/JobSystem.hpp"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+static const size_t BLOCK_SIZE = 4;
+static const size_t BLOCK_ROWS_PER_JOB = 4;
+static const int REFINE_PASSES = 2;
+static const int BC7_MODE6_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/**
+* @brief Block pixels as floats; BC1 fits the first 3 channels, BC7 all 4.
+*/
+struct BlockColors {
+	float values[TextureEncoder::BLOCK_PIXELS][4];
+	int channels;
+};
+
+static BlockColors toFloat(const uint8_t rgba[TextureEncoder::BLOCK_PIXELS][4], int channels) {
+	BlockColors colors;
+	colors.channels = channels;
+	for (size_t i = 0; i < TextureEncoder::BLOCK_PIXELS; i++) {
+		for (int k = 0; k < 4; k++) {
+			colors.values[i][k] = rgba[i][k];
+		}
+	}
+	return colors;
+}
+
+static float clampByte(float value) {
+	return min(255.0f, max(0.0f, value));
+}
+
+/**
+* @brief Ends of the principal axis of the block colors, the first one
+* towards dark. The axis comes from a few power iterations on the
+* covariance matrix, started along the bounding box diagonal.
+*/
+static void fitLine(const BlockColors &colors, float lo[4], float hi[4]) {
+	const int n = colors.channels;
+	float mean[4] = {0, 0, 0, 0};
+	for (const float *p : colors.values) {
+		for (int k = 0; k < n; k++) {
+			mean[k] += p[k] / TextureEncoder::BLOCK_PIXELS;
+		}
+	}
+
+	float cov[4][4] = {};
+	float minColor[4] = {255, 255, 255, 255}, maxColor[4] = {0, 0, 0, 0};
+	for (const float *p : colors.values) {
+		for (int j = 0; j < n; j++) {
+			for (int k = 0; k < n; k++) {
+				cov[j][k] += (p[j] - mean[j]) * (p[k] - mean[k]);
+			}
+			minColor[j] = min(minColor[j], p[j]);
+			maxColor[j] = max(maxColor[j], p[j]);
+		}
+	}
+
+	float axis[4] = {0, 0, 0, 0};
+	for (int k = 0; k < n; k++) {
+		axis[k] = maxColor[k] - minColor[k];
+	}
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = {0, 0, 0, 0};
+		float length = 0;
+		for (int j = 0; j < n; j++) {
+			for (int k = 0; k < n; k++) {
+				next[j] += cov[j][k] * axis[k];
+			}
+			length = max(length, fabs(next[j]));
+		}
+		if (length < 1e-6f) {
+			break;
+		}
+		for (int k = 0; k < n; k++) {
+			axis[k] = next[k] / length;
+		}
+	}
+
+	float length = 0, direction = 0;
+	for (int k = 0; k < n; k++) {
+		length += axis[k] * axis[k];
+		direction += axis[k];
+	}
+	length = sqrt(length);
+	if (length < 1e-6f) {
+		for (int k = 0; k < n; k++) {
+			lo[k] = hi[k] = mean[k];
+		}
+		return;
+	}
+	for (int k = 0; k < n; k++) {
+		axis[k] /= (direction < 0) ? -length : length;
+	}
+
+	float tMin = 0, tMax = 0;
+	for (const float *p : colors.values) {
+		float t = 0;
+		for (int k = 0; k < n; k++) {
+			t += (p[k] - mean[k]) * axis[k];
+		}
+		tMin = min(tMin, t);
+		tMax = max(tMax, t);
+	}
+	for (int k = 0; k < n; k++) {
+		lo[k] = clampByte(mean[k] + tMin * axis[k]);
+		hi[k] = clampByte(mean[k] + tMax * axis[k]);
+	}
+}
+
+/**
+* @brief Endpoints `a`, `b` that minimize the squared error of
+* p = (1 - w) * a + w * b over the block, for the weights the indices
+* picked. False when the weights cannot separate two endpoints.
+*/
+static bool solveEndpoints(const BlockColors &colors, const float weights[TextureEncoder::BLOCK_PIXELS],
+	float a[4], float b[4])
+{
+	const int n = colors.channels;
+	float aa = 0, ab = 0, bb = 0;
+	float pa[4] = {0, 0, 0, 0}, pb[4] = {0, 0, 0, 0};
+	for (size_t i = 0; i < TextureEncoder::BLOCK_PIXELS; i++) {
+		const float w = weights[i];
+		aa += (1 - w) * (1 - w);
+		ab += (1 - w) * w;
+		bb += w * w;
+		for (int k = 0; k < n; k++) {
+			pa[k] += (1 - w) * colors.values[i][k];
+			pb[k] += w * colors.values[i][k];
+		}
+	}
+	const float determinant = aa * bb - ab * ab;
+	if (fabs(determinant) < 1e-6f) {
+		return false;
+	}
+	for (int k = 0; k < n; k++) {
+		a[k] = clampByte((pa[k] * bb - pb[k] * ab) / determinant);
+		b[k] = clampByte((pb[k] * aa - pa[k] * ab) / determinant);
+	}
+	return true;
+}
+
+static int squaredDistance(const int a[4], const uint8_t b[4], int channels) {
+	int sum = 0;
+	for (int k = 0; k < channels; k++) {
+		sum += (a[k] - b[k]) * (a[k] - b[k]);
+	}
+	return sum;
+}
+
+// BC1 //
+
+static uint16_t packRGB565(const float c[3]) {
+	const int r = static_cast<int>(lround(clampByte(c[0]) * 31 / 255));
+	const int g = static_cast<int>(lround(clampByte(c[1]) * 63 / 255));
+	const int b = static_cast<int>(lround(clampByte(c[2]) * 31 / 255));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t value, int out[3]) {
+	const int r = value >> 11, g = (value >> 5) & 63, b = value & 31;
+	out[0] = (r << 3) | (r >> 2);
+	out[1] = (g << 2) | (g >> 4);
+	out[2] = (b << 3) | (b >> 2);
+}
+
+// the four colors of a block, in the 3 color + black mode when c0 <= c1
+static void getBC1Palette(uint16_t c0, uint16_t c1, int palette[4][4]) {
+	unpackRGB565(c0, palette[0]);
+	unpackRGB565(c1, palette[1]);
+	for (int k = 0; k < 3; k++) {
+		if (c0 > c1) {
+			palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+			palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+		} else {
+			palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+			palette[3][k] = 0;
+		}
+	}
+}
+
+struct BC1Candidate {
+	uint16_t c0;
+	uint16_t c1;
+	uint32_t indices;
+	int error;
+};
+
+// quantizes the endpoints in 4 color order and picks the nearest palette entry per pixel
+static BC1Candidate tryBC1(const uint8_t rgba[TextureEncoder::BLOCK_PIXELS][4], const float a[3], const float b[3]) {
+	BC1Candidate candidate;
+	candidate.c0 = packRGB565(a);
+	candidate.c1 = packRGB565(b);
+	if (candidate.c0 < candidate.c1) {
+		swap(candidate.c0, candidate.c1);
+	}
+	int palette[4][4];
+	getBC1Palette(candidate.c0, candidate.c1, palette);
+	// equal endpoints select the 3 color mode, whose 4th entry is black
+	const int entries = (candidate.c0 == candidate.c1) ? 3 : 4;
+
+	candidate.indices = 0;
+	candidate.error = 0;
+	for (size_t i = 0; i < TextureEncoder::BLOCK_PIXELS; i++) {
+		int best = 0;
+		int bestError = squaredDistance(palette[0], rgba[i], 3);
+		for (int entry = 1; entry < entries; entry++) {
+			const int error = squaredDistance(palette[entry], rgba[i], 3);
+			if (error < bestError) {
+				best = entry;
+				bestError = error;
+			}
+		}
+		candidate.indices |= static_cast<uint32_t>(best) << (2 * i);
+		candidate.error += bestError;
+	}
+	return candidate;
+}
+
+/**
+* @brief One BC1 block in the 4 color mode: the principal axis gives the
+* first endpoints, least squares over the chosen indices refines them
+* while the error drops. Alpha is ignored.
+*/
+void TextureEncoder::encodeBC1Block(const uint8_t rgba[BLOCK_PIXELS][4], uint8_t out[8]) {
+	static const float INDEX_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3, 2.0f / 3};  // of c1 against c0
+
+	const BlockColors colors = toFloat(rgba, 3);
+	float a[4], b[4];
+	fitLine(colors, a, b);
+	BC1Candidate best = tryBC1(rgba, a, b);
+
+	for (int pass = 0; pass < REFINE_PASSES && best.error > 0; pass++) {
+		float weights[BLOCK_PIXELS];
+		for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+			weights[i] = INDEX_WEIGHTS[(best.indices >> (2 * i)) & 3];
+		}
+		if (!solveEndpoints(colors, weights, a, b)) {
+			break;
+		}
+		const BC1Candidate candidate = tryBC1(rgba, a, b);
+		if (candidate.error >= best.error) {
+			break;
+		}
+		best = candidate;
+	}
+
+	out[0] = static_cast<uint8_t>(best.c0);
+	out[1] = static_cast<uint8_t>(best.c0 >> 8);
+	out[2] = static_cast<uint8_t>(best.c1);
+	out[3] = static_cast<uint8_t>(best.c1 >> 8);
+	for (int k = 0; k < 4; k++) {
+		out[4 + k] = static_cast<uint8_t>(best.indices >> (8 * k));
+	}
+}
+
+void TextureEncoder::decodeBC1Block(const uint8_t block[8], uint8_t rgba[BLOCK_PIXELS][4]) {
+	const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+	uint32_t indices = 0;
+	for (int k = 0; k < 4; k++) {
+		indices |= static_cast<uint32_t>(block[4 + k]) << (8 * k);
+	}
+
+	int palette[4][4];
+	getBC1Palette(c0, c1, palette);
+	for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+		const int entry = (indices >> (2 * i)) & 3;
+		for (int k = 0; k < 3; k++) {
+			rgba[i][k] = static_cast<uint8_t>(palette[entry][k]);
+		}
+		rgba[i][3] = 255;  // the RGB variant, black stays opaque
+	}
+}
+
+// BC7 //
+
+/**
+* @brief Bits written from the least significant end, as BC7 lays out
+* its fields.
+*/
+class BitWriter {
+public:
+	explicit BitWriter(uint8_t *out) : _out(out) {
+		memset(_out, 0, 16);
+	}
+
+	void write(uint32_t value, int bits) {
+		for (int k = 0; k < bits; k++, _position++) {
+			_out[_position / 8] |= static_cast<uint8_t>(((value >> k) & 1) << (_position % 8));
+		}
+	}
+
+private:
+	uint8_t *_out;
+	int _position = 0;
+};
+
+class BitReader {
+public:
+	explicit BitReader(const uint8_t *in) : _in(in) {}
+
+	uint32_t read(int bits) {
+		uint32_t value = 0;
+		for (int k = 0; k < bits; k++, _position++) {
+			value |= static_cast<uint32_t>((_in[_position / 8] >> (_position % 8)) & 1) << k;
+		}
+		return value;
+	}
+
+private:
+	const uint8_t *_in;
+	int _position = 0;
+};
+
+struct BC7Endpoint {
+	uint8_t color[4];  // 7 bit values
+	uint8_t pBit;
+
+	int expand(int k) const {
+		return (color[k] << 1) | pBit;
+	}
+};
+
+// the 7 bit components and shared p-bit closest to `c`; opaque stays 255
+static BC7Endpoint quantizeBC7(const float c[4]) {
+	BC7Endpoint best = {};
+	float bestError = -1;
+	const uint8_t firstPBit = (c[3] > 254.5f) ? 1 : 0;
+	for (uint8_t pBit = firstPBit; pBit < 2; pBit++) {
+		BC7Endpoint endpoint;
+		endpoint.pBit = pBit;
+		float error = 0;
+		for (int k = 0; k < 4; k++) {
+			const long q = lround((clampByte(c[k]) - pBit) / 2);
+			endpoint.color[k] = static_cast<uint8_t>(min(127L, max(0L, q)));
+			const float d = endpoint.expand(k) - c[k];
+			error += d * d;
+		}
+		if (bestError < 0 || error < bestError) {
+			best = endpoint;
+			bestError = error;
+		}
+	}
+	return best;
+}
+
+struct BC7Candidate {
+	BC7Endpoint e0;
+	BC7Endpoint e1;
+	uint8_t indices[TextureEncoder::BLOCK_PIXELS];
+	int error;
+};
+
+static BC7Candidate tryBC7(const uint8_t rgba[TextureEncoder::BLOCK_PIXELS][4], const float a[4], const float b[4]) {
+	BC7Candidate candidate;
+	candidate.e0 = quantizeBC7(a);
+	candidate.e1 = quantizeBC7(b);
+
+	int palette[16][4];
+	for (int entry = 0; entry < 16; entry++) {
+		const int w = BC7_MODE6_WEIGHTS[entry];
+		for (int k = 0; k < 4; k++) {
+			palette[entry][k] = ((64 - w) * candidate.e0.expand(k) + w * candidate.e1.expand(k) + 32) >> 6;
+		}
+	}
+
+	candidate.error = 0;
+	for (size_t i = 0; i < TextureEncoder::BLOCK_PIXELS; i++) {
+		int best = 0;
+		int bestError = squaredDistance(palette[0], rgba[i], 4);
+		for (int entry = 1; entry < 16; entry++) {
+			const int error = squaredDistance(palette[entry], rgba[i], 4);
+			if (error < bestError) {
+				best = entry;
+				bestError = error;
+			}
+		}
+		candidate.indices[i] = static_cast<uint8_t>(best);
+		candidate.error += bestError;
+	}
+	return candidate;
+}
+
+/**
+* @brief One BC7 block in mode 6. The fit is the one of BC1 in RGBA with
+* 16 interpolation steps; the endpoints are swapped at the end when the
+* first pixel would need the high bit of its index, which mode 6 drops.
+*/
+void TextureEncoder::encodeBC7Block(const uint8_t rgba[BLOCK_PIXELS][4], uint8_t out[16]) {
+	const BlockColors colors = toFloat(rgba, 4);
+	float a[4], b[4];
+	fitLine(colors, a, b);
+	BC7Candidate best = tryBC7(rgba, a, b);
+
+	for (int pass = 0; pass < REFINE_PASSES && best.error > 0; pass++) {
+		float weights[BLOCK_PIXELS];
+		for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+			weights[i] = BC7_MODE6_WEIGHTS[best.indices[i]] / 64.0f;
+		}
+		if (!solveEndpoints(colors, weights, a, b)) {
+			break;
+		}
+		const BC7Candidate candidate = tryBC7(rgba, a, b);
+		if (candidate.error >= best.error) {
+			break;
+		}
+		best = candidate;
+	}
+
+	if (best.indices[0] & 8) {
+		swap(best.e0, best.e1);
+		for (uint8_t &index : best.indices) {
+			index = static_cast<uint8_t>(15 - index);
+		}
+	}
+
+	BitWriter bits(out);
+	bits.write(1 << 6, 7);  // mode 6
+	for (int k = 0; k < 4; k++) {
+		bits.write(best.e0.color[k], 7);
+		bits.write(best.e1.color[k], 7);
+	}
+	bits.write(best.e0.pBit, 1);
+	bits.write(best.e1.pBit, 1);
+	bits.write(best.indices[0], 3);
+	for (size_t i = 1; i < BLOCK_PIXELS; i++) {
+		bits.write(best.indices[i], 4);
+	}
+}
+
+/**
+* @return false, with the block left magenta, for modes other than 6.
+*/
+bool TextureEncoder::decodeBC7Block(const uint8_t block[16], uint8_t rgba[BLOCK_PIXELS][4]) {
+	if ((block[0] & 0x7F) != 0x40) {
+		for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+			rgba[i][0] = rgba[i][2] = rgba[i][3] = 255;
+			rgba[i][1] = 0;
+		}
+		return false;
+	}
+
+	BitReader bits(block);
+	bits.read(7);
+	BC7Endpoint e0, e1;
+	for (int k = 0; k < 4; k++) {
+		e0.color[k] = static_cast<uint8_t>(bits.read(7));
+		e1.color[k] = static_cast<uint8_t>(bits.read(7));
+	}
+	e0.pBit = static_cast<uint8_t>(bits.read(1));
+	e1.pBit = static_cast<uint8_t>(bits.read(1));
+
+	for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+		const int w = BC7_MODE6_WEIGHTS[bits.read(i == 0 ? 3 : 4)];
+		for (int k = 0; k < 4; k++) {
+			rgba[i][k] = static_cast<uint8_t>(((64 - w) * e0.expand(k) + w * e1.expand(k) + 32) >> 6);
+		}
+	}
+	return true;
+}
+
+// chains //
+
+/**
+* @brief Compresses every level of an uncompressed chain. Levels
+* smaller than a block are padded by repeating their last row and
+* column. Rows of blocks are spread over the job system.
+*/
+MipChain TextureEncoder::encode(const MipChain &chain, TextureCompression compression) {
+	if (compression == COMPRESSION_NONE || chain.isCompressed()) {
+		return chain;
+	}
+
+	const TextureFormat format = (compression == COMPRESSION_BC1) ? TEXTURE_BC1 : TEXTURE_BC7;
+	const size_t blockBytes = (format == TEXTURE_BC1) ? 8 : 16;
+	const uint32_t channels = chain.getChannels();
+
+	vector<MipLevel> levels;
+	size_t total = 0;
+	for (const MipLevel &source : chain.getLevels()) {
+		const size_t size = MipChain::getLevelBytes(format, source.width, source.height);
+		levels.push_back({source.width, source.height, total, size});
+		total += size;
+	}
+	vector<unsigned char> pixels(total);
+
+	for (size_t l = 0; l < levels.size(); l++) {
+		const MipLevel &level = levels[l];
+		const unsigned char *source = chain.getLevelData(l);
+		const size_t rowBytes = MipChain::getRowBytes(level.width, channels);
+		const size_t blocksX = (level.width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		const size_t blocksY = (level.height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		unsigned char *out = pixels.data() + level.offset;
+
+		JobSystem::getShared().parallelFor(blocksY, BLOCK_ROWS_PER_JOB, [&](size_t begin, size_t end) {
+			uint8_t rgba[BLOCK_PIXELS][4];
+			for (size_t by = begin; by < end; by++) {
+				for (size_t bx = 0; bx < blocksX; bx++) {
+					for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+						const size_t x = min<size_t>(bx * BLOCK_SIZE + i % BLOCK_SIZE, level.width - 1);
+						const size_t y = min<size_t>(by * BLOCK_SIZE + i / BLOCK_SIZE, level.height - 1);
+						const unsigned char *pixel = source + y * rowBytes + x * channels;
+						rgba[i][0] = pixel[2];
+						rgba[i][1] = pixel[1];
+						rgba[i][2] = pixel[0];
+						rgba[i][3] = (channels == 4) ? pixel[3] : 255;
+					}
+					uint8_t *block = out + (by * blocksX + bx) * blockBytes;
+					if (format == TEXTURE_BC1) {
+						encodeBC1Block(rgba, block);
+					} else {
+						encodeBC7Block(rgba, block);
+					}
+				}
+			}
+		});
+	}
+	return MipChain(format, move(levels), move(pixels));
+}
+
+/**
+* @brief Expands a compressed chain to BGRA8, for drivers without the
+* format. Uncompressed chains are returned as they are.
+*/
+MipChain TextureEncoder::decode(const MipChain &chain) {
+	if (!chain.isCompressed()) {
+		return chain;
+	}
+
+	const TextureFormat format = chain.getFormat();
+	const size_t blockBytes = (format == TEXTURE_BC1) ? 8 : 16;
+
+	vector<MipLevel> levels;
+	size_t total = 0;
+	for (const MipLevel &source : chain.getLevels()) {
+		const size_t size = MipChain::getLevelBytes(TEXTURE_BGRA8, source.width, source.height);
+		levels.push_back({source.width, source.height, total, size});
+		total += size;
+	}
+	vector<unsigned char> pixels(total);
+
+	for (size_t l = 0; l < levels.size(); l++) {
+		const MipLevel &level = levels[l];
+		const unsigned char *source = chain.getLevelData(l);
+		const size_t rowBytes = MipChain::getRowBytes(level.width, 4);
+		const size_t blocksX = (level.width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		const size_t blocksY = (level.height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		unsigned char *out = pixels.data() + level.offset;
+
+		JobSystem::getShared().parallelFor(blocksY, BLOCK_ROWS_PER_JOB, [&](size_t begin, size_t end) {
+			uint8_t rgba[BLOCK_PIXELS][4];
+			for (size_t by = begin; by < end; by++) {
+				for (size_t bx = 0; bx < blocksX; bx++) {
+					const uint8_t *block = source + (by * blocksX + bx) * blockBytes;
+					if (format == TEXTURE_BC1) {
+						decodeBC1Block(block, rgba);
+					} else {
+						decodeBC7Block(block, rgba);
+					}
+					for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+						const size_t x = bx * BLOCK_SIZE + i % BLOCK_SIZE;
+						const size_t y = by * BLOCK_SIZE + i / BLOCK_SIZE;
+						if (x < level.width && y < level.height) {
+							unsigned char *pixel = out + y * rowBytes + x * 4;
+							pixel[0] = rgba[i][2];
+							pixel[1] = rgba[i][1];
+							pixel[2] = rgba[i][0];
+							pixel[3] = rgba[i][3];
+						}
+					}
+				}
+			}
+		});
+	}
+	return MipChain(TEXTURE_BGRA8, move(levels), move(pixels));
+}
@@ -0,0 +1,33 @@
+/**
+* @file TextureEncoder.hpp
+* @brief CPU block compression of mip chains into BC1 and BC7.
+*
+* Both encoders fit the colors of a 4x4 block to a line in RGB space
+* (principal axis through the mean), quantize its ends to the endpoint
+* precision of the format and refine them by least squares over the
+* chosen indices. BC7 blocks are always written in mode 6 (one subset,
+* 7.7.7.7 endpoints with p-bits, 4-bit indices), which covers smooth and
+* noisy blocks well without the partition search of the other modes.
+*
+* Blocks are independent and encoded in parallel on the job system. The
+* decoders exist so that drivers without the format, and tools measuring
+* the quality, can get the pixels back; the BC7 one reads mode 6 only.
+*/
+
+#pragma once
+
+#include "MipChain.hpp"
+#include <cstdint>
+
+namespace TextureEncoder {
+	static constexpr size_t BLOCK_PIXELS = 16;
+
+	MipChain encode(const MipChain &chain, TextureCompression compression);
+	MipChain decode(const MipChain &chain);
+
+	// rgba: the 16 pixels of a block, row by row, as R, G, B, A bytes
+	void encodeBC1Block(const uint8_t rgba[BLOCK_PIXELS][4], uint8_t out[8]);
+	void encodeBC7Block(const uint8_t rgba[BLOCK_PIXELS][4], uint8_t out[16]);
+	void decodeBC1Block(const uint8_t block[8], uint8_t rgba[BLOCK_PIXELS][4]);
+	bool decodeBC7Block(const uint8_t block[16], uint8_t rgba[BLOCK_PIXELS][4]);
+}
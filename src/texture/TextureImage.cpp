@@ -0,0 +1,81 @@
+#include "TextureImage.hpp"
+#include "BMPLoader.hpp"
+#include "QOILoader.hpp"
+#include "MipChain.hpp"
+#include "MipCache.hpp"
+#include "TextureEncoder.hpp"
+#include "../ResourcePath.hpp"
+#include <string>
+#include <string_view>
+#include <functional>
+#include <optional>
+#include <utility>
+
+using namespace std;
+
+// level 0 of the BMP at `path`, read in place from the mapped file
+static MipChain decodeBMP(const string &path) {
+	BMPLoader bmp(path);
+	const Header *header = bmp.getBMPHeader();
+	const uint32_t channels = static_cast<uint32_t>(bmp.channels);
+	const size_t size = MipChain::getRowBytes(header->width, channels) * header->height;
+	if ((channels != 3 && channels != 4) || header->width == 0 || header->height == 0
+		|| bmp.getPixelDataSize() < size) {
+		throw BMPLoaderException(BMPLoaderException::INVALID_FORMAT, path);
+	}
+	const TextureFormat format = (channels == 4) ? TEXTURE_BGRA8 : TEXTURE_BGR8;
+	return MipChain(format, {{header->width, header->height, 0, size}}, bmp.getFile(), bmp.getPixelDataOffset());
+}
+
+// level 0 of the image at `path`, a QOI or a BMP file by its magic bytes
+static MipChain decodeImage(const string &path) {
+	if (QOILoader::isQOIFile(path)) {
+		return QOILoader(path).takeImage();
+	}
+	return decodeBMP(path);
+}
+
+static size_t hashContents(const MipChain &mips) {
+	const MipLevel &base = mips.getLevel(0);
+	string_view pixels(reinterpret_cast<const char *>(mips.getLevelData(0)), base.size);
+
+	size_t hash = std::hash<string_view>()(pixels);
+	for (size_t value : {size_t(base.width), size_t(base.height), size_t(mips.getFormat())}) {
+		hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+	}
+	return hash;
+}
+
+/**
+* @brief Decodes the image at `path`.
+*
+* With MIPMAP_CPU the levels are read from the image's MipCache when it
+* is current, otherwise built with MipChain::buildLevels(), compressed
+* by TextureEncoder if asked for, and cached; a cache that cannot be
+* written only costs the next load the work. Each compression has its
+* own cache file. With MIPMAP_GPU and no compression only level 0 is
+* decoded, compressed levels cannot be generated by the driver.
+*
+* @throws BMPLoaderException or QOILoaderException if the file cannot be read.
+*/
+TextureImage TextureImage::load(const string &path, const TextureOptions &options) {
+	const string source = ResourcePath::getPath(path);
+	if (options.mipmaps == MIPMAP_GPU && options.compression == COMPRESSION_NONE) {
+		MipChain chain = decodeImage(source);
+		size_t hash = hashContents(chain);
+		return TextureImage{move(chain), hash, false};
+	}
+
+	MipCache cache(source, options.compression);
+	if (optional<MipChain> cached = cache.load()) {
+		size_t hash = hashContents(*cached);
+		return TextureImage{move(*cached), hash, true};
+	}
+
+	MipChain chain = decodeImage(source);
+	chain.buildLevels();
+	chain = TextureEncoder::encode(chain, options.compression);
+	cache.store(chain);
+	size_t hash = hashContents(chain);
+	return TextureImage{move(chain), hash, false};
+}
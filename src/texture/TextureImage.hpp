@@ -0,0 +1,42 @@
+/**
+* @file TextureImage.hpp
+* @brief A decoded texture image tagged with a hash of its contents.
+*
+* Decoding needs no GL context, so images can be prepared on loader
+* threads and uploaded later through TextureCache. Level 0 of a BMP and
+* cached levels are not copied, they are read from the mapped files,
+* which stay mapped only as long as the image: once it is uploaded and
+* dropped, nothing of the texture is left in CPU memory. QOI images are
+* decoded into a buffer of their own, released the same way.
+*/
+
+#pragma once
+
+#include "MipChain.hpp"
+#include <string>
+#include <cstddef>
+
+/**
+* @struct TextureOptions
+* @brief How TextureImage::load() prepares the levels.
+*/
+struct TextureOptions {
+	MipmapMode mipmaps = MIPMAP_CPU;
+	TextureCompression compression = COMPRESSION_NONE;  // anything else implies MIPMAP_CPU
+};
+
+/**
+* @struct TextureImage
+* @brief The levels of an image and the hash that identifies it in TextureCache.
+*
+* The hash covers the size, the pixel format and every byte of level 0,
+* so copies of one file under different names share a texture, while
+* compressed and uncompressed loads of one file do not.
+*/
+struct TextureImage {
+	MipChain mips;
+	size_t contentHash;
+	bool fromCache;  // the levels came from a MipCache file
+
+	static TextureImage load(const std::string &path, const TextureOptions &options = TextureOptions());
+};